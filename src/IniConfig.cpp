@@ -27,6 +27,7 @@
 
 #include <fmt/format.h>
 
+#include <iterator>
 #include <string>
 
 #include <cstring>
@@ -109,6 +110,8 @@ void IniConfig::clear()
     sidplay2_s.database.clear();
     sidplay2_s.playLength   = 0;           // INFINITE
     sidplay2_s.recordLength = (3 * 60 + 30) * 1000; // 3.5 minutes
+    sidplay2_s.endDetectTime = 0;          // disabled
+    sidplay2_s.renderCacheSize = 0;        // disabled
     sidplay2_s.kernalRom.clear();
     sidplay2_s.basicRom.clear();
     sidplay2_s.chargenRom.clear();
@@ -137,6 +140,14 @@ void IniConfig::clear()
     audio_s.channels  = 0;
     audio_s.precision = 16;
     audio_s.bufLength = 0;
+    audio_s.panning[0] = -1.;  // default positions
+    audio_s.panning[1] = -1.;
+    audio_s.panning[2] = -1.;
+    audio_s.queueDepth = 4;
+    audio_s.rtPriority = 0;
+    audio_s.rtRoundRobin = false;
+    audio_s.cpuAffinity = -1;
+    audio_s.lockMemory = false;
 
     emulation_s.modelDefault  = SidConfig::PAL;
     emulation_s.modelForced   = false;
@@ -161,6 +172,9 @@ void IniConfig::clear()
     emulation_s.powerOnDelay = -1;
     emulation_s.samplingMethod = SidConfig::RESAMPLE_INTERPOLATE;
     emulation_s.fastSampling = false;
+    emulation_s.playChunk    = 2000;
+    emulation_s.recordChunk  = 20000;
+    emulation_s.autoFallback = false;
 }
 
 
@@ -375,6 +389,27 @@ void IniConfig::readSidplay2(iniHandler &ini)
 
     sidplay2_s.database = readString(ini, "Songlength Database");
 
+    int time;
+    if (readTime(ini, "Default Play Length", time))
+        sidplay2_s.playLength = time;
+    if (readTime(ini, "Default Record Length", time))
+        sidplay2_s.recordLength = time;
+    if (readTime(ini, "End Detection Time", time))
+        sidplay2_s.endDetectTime = time;
+
+    readInt(ini, "Render Cache Size", sidplay2_s.renderCacheSize);
+
+    sidplay2_s.kernalRom = readString(ini, "Kernal Rom");
+    sidplay2_s.basicRom = readString(ini, "Basic Rom");
+    sidplay2_s.chargenRom = readString(ini, "Chargen Rom");
+
+    readInt(ini, "VerboseLevel", sidplay2_s.verboseLevel);
+}
+
+// Not part of the cached configuration,
+// the file may appear at any time
+void IniConfig::findDatabase()
+{
     if (sidplay2_s.database.empty())
     {
         std::string buffer(utils::getDataPath());
@@ -391,18 +426,6 @@ void IniConfig::readSidplay2(iniHandler &ini)
                 sidplay2_s.database.assign(buffer);
         }
     }
-
-    int time;
-    if (readTime(ini, "Default Play Length", time))
-        sidplay2_s.playLength = time;
-    if (readTime(ini, "Default Record Length", time))
-        sidplay2_s.recordLength = time;
-
-    sidplay2_s.kernalRom = readString(ini, "Kernal Rom");
-    sidplay2_s.basicRom = readString(ini, "Basic Rom");
-    sidplay2_s.chargenRom = readString(ini, "Chargen Rom");
-
-    readInt(ini, "VerboseLevel", sidplay2_s.verboseLevel);
 }
 
 
@@ -459,6 +482,26 @@ void IniConfig::readAudio(iniHandler &ini)
     readInt(ini, "BitsPerSample", audio_s.precision);
 
     readInt(ini, "BufferLength", audio_s.bufLength);
+
+    readDouble(ini, "Panning1", audio_s.panning[0]);
+    readDouble(ini, "Panning2", audio_s.panning[1]);
+    readDouble(ini, "Panning3", audio_s.panning[2]);
+
+    readInt(ini, "QueueDepth", audio_s.queueDepth);
+
+    readInt(ini, "RealtimePriority", audio_s.rtPriority);
+    {
+        std::string str = readString(ini, "RealtimePolicy");
+        if (!str.empty())
+        {
+            if (str.compare("FIFO") == 0)
+                audio_s.rtRoundRobin = false;
+            else if (str.compare("RR") == 0)
+                audio_s.rtRoundRobin = true;
+        }
+    }
+    readInt(ini, "CpuAffinity", audio_s.cpuAffinity);
+    readBool(ini, "LockMemory", audio_s.lockMemory);
 }
 
 
@@ -562,6 +605,11 @@ void IniConfig::readEmulation(iniHandler &ini)
     }
 
     readBool(ini, "ResidFastSampling", emulation_s.fastSampling);
+
+    readInt(ini, "PlayChunk", emulation_s.playChunk);
+    readInt(ini, "RecordChunk", emulation_s.recordChunk);
+
+    readBool(ini, "AutoFallback", emulation_s.autoFallback);
 }
 
 class iniError
@@ -650,50 +698,294 @@ std::string getConfigPath()
     return configPath;
 }
 
-bool tryOpen(MAYBE_UNUSED iniHandler &ini)
+std::string findConfigFile()
 {
 #ifdef _WIN32
     {
         // Try exec dir first
         std::string execPath(utils::getExecPath());
         execPath.append(SEPARATOR).append(FILE_NAME);
-        if (ini.tryOpen(execPath.c_str()))
-            return true;
+        std::error_code ec;
+        if (fs::is_regular_file(execPath, ec))
+            return execPath;
     }
 #endif
-    return false;
+    return getConfigPath();
 }
 
-void IniConfig::read()
+/*
+ * Binary snapshot of the parsed configuration, stored in the cache
+ * dir and valid as long as the config file keeps its path, size
+ * and modification time. It's native endian and layout, being
+ * specific to the machine and build.
+ */
+
+// Change when the cached settings change
+constexpr uint_least32_t CACHE_VERSION = 3;
+
+const char CACHE_MAGIC[8] = { 'S', 'P', 'F', 'C', 'O', 'N', 'F', '\0' };
+const char *CACHE_NAME = "sidplayfp.ini.cache";
+
+class cacheWriter
 {
-    clear();
+private:
+    std::string m_data;
 
-    iniHandler ini;
+public:
+    template<typename T>
+    void operator()(const T &value) { m_data.append(reinterpret_cast<const char*>(&value), sizeof(T)); }
 
-    if (!tryOpen(ini))
+    void operator()(const std::string &value)
     {
-        try
+        (*this)(static_cast<uint_least32_t>(value.size()));
+        m_data.append(value);
+    }
+
+    const std::string &data() const { return m_data; }
+};
+
+class cacheReader
+{
+private:
+    const std::string &m_data;
+    std::size_t m_pos;
+    bool m_valid;
+
+public:
+    explicit cacheReader(const std::string &data) : m_data(data), m_pos(0), m_valid(true) {}
+
+    template<typename T>
+    void operator()(T &value)
+    {
+        if (m_data.size() - m_pos < sizeof(T))
         {
-            std::string configPath = getConfigPath();
+            m_valid = false;
+            return;
+        }
+        std::memcpy(&value, m_data.data() + m_pos, sizeof(T));
+        m_pos += sizeof(T);
+    }
 
-            // Opens an existing file or creates a new one
-            if (!ini.open(configPath.c_str()))
-            {
-                error("Error reading config file!");
-                return;
-            }
-        } catch (iniError const &e) {
-            error(e.message().c_str());
+    void operator()(std::string &value)
+    {
+        uint_least32_t size = 0;
+        (*this)(size);
+        if (!m_valid || (m_data.size() - m_pos < size))
+        {
+            m_valid = false;
             return;
         }
+        value.assign(m_data, m_pos, size);
+        m_pos += size;
+    }
+
+    bool valid() const { return m_valid && (m_pos == m_data.size()); }
+};
+
+// What identifies a version of the config file
+template<class T>
+bool cacheHeader(T &archive, const std::string &configPath)
+{
+    std::error_code ec;
+    const fs::file_time_type time = fs::last_write_time(configPath, ec);
+    if (ec)
+        return false;
+    const uintmax_t size = fs::file_size(configPath, ec);
+    if (ec)
+        return false;
+
+    for (char c : CACHE_MAGIC)
+        archive(c);
+    archive(CACHE_VERSION);
+    archive(static_cast<uint_least32_t>(sizeof(IniConfig::sidplay2_section) + sizeof(IniConfig::console_section)
+        + sizeof(IniConfig::audio_section) + sizeof(IniConfig::emulation_section)));
+    archive(configPath);
+    archive(static_cast<int_least64_t>(time.time_since_epoch().count()));
+    archive(static_cast<uint_least64_t>(size));
+    return true;
+}
+
+std::string getCacheFile()
+{
+    std::string cachePath(utils::getCachePath());
+    cachePath.append(SEPARATOR).append(DIR_NAME);
+    std::error_code ec;
+    fs::create_directories(cachePath, ec);
+    return cachePath.append(SEPARATOR).append(CACHE_NAME);
+}
+
+template<class T>
+void IniConfig::transfer(T &archive)
+{
+    archive(sidplay2_s.version);
+    archive(sidplay2_s.database);
+    archive(sidplay2_s.playLength);
+    archive(sidplay2_s.recordLength);
+    archive(sidplay2_s.endDetectTime);
+    archive(sidplay2_s.renderCacheSize);
+    archive(sidplay2_s.kernalRom);
+    archive(sidplay2_s.basicRom);
+    archive(sidplay2_s.chargenRom);
+    archive(sidplay2_s.verboseLevel);
+
+    archive(console_s.ansi);
+    archive(console_s.topLeft);
+    archive(console_s.topRight);
+    archive(console_s.bottomLeft);
+    archive(console_s.bottomRight);
+    archive(console_s.vertical);
+    archive(console_s.horizontal);
+    archive(console_s.junctionLeft);
+    archive(console_s.junctionRight);
+    archive(console_s.decorations);
+    archive(console_s.title);
+    archive(console_s.label_core);
+    archive(console_s.text_core);
+    archive(console_s.label_extra);
+    archive(console_s.text_extra);
+    archive(console_s.notes);
+    archive(console_s.control_on);
+    archive(console_s.control_off);
+
+    archive(audio_s.frequency);
+    archive(audio_s.channels);
+    archive(audio_s.precision);
+    archive(audio_s.bufLength);
+    archive(audio_s.panning);
+    archive(audio_s.queueDepth);
+    archive(audio_s.rtPriority);
+    archive(audio_s.rtRoundRobin);
+    archive(audio_s.cpuAffinity);
+    archive(audio_s.lockMemory);
+
+    archive(emulation_s.engine);
+    archive(emulation_s.modelDefault);
+    archive(emulation_s.modelForced);
+    archive(emulation_s.sidModel);
+    archive(emulation_s.forceModel);
+    archive(emulation_s.ciaModel);
+    archive(emulation_s.digiboost);
+    archive(emulation_s.filter);
+    archive(emulation_s.bias);
+    archive(emulation_s.filterCurve6581);
+#ifdef FEAT_FILTER_RANGE
+    archive(emulation_s.filterRange6581);
+#endif
+    archive(emulation_s.filterCurve8580);
+#ifdef FEAT_CW_STRENGTH
+    archive(emulation_s.combinedWaveformsStrength);
+#endif
+#ifdef FEAT_RESID_CAPS
+    archive(emulation_s.old6581Caps);
+#endif
+    archive(emulation_s.powerOnDelay);
+    archive(emulation_s.samplingMethod);
+    archive(emulation_s.fastSampling);
+    archive(emulation_s.playChunk);
+    archive(emulation_s.recordChunk);
+    archive(emulation_s.autoFallback);
+}
+
+bool IniConfig::loadCache(const std::string &configPath)
+{
+    cacheWriter expected;
+    if (!cacheHeader(expected, configPath))
+        return false;
+
+    std::string data;
+    try
+    {
+        fs::ifstream cacheFile(getCacheFile(), std::ios::binary);
+        if (!cacheFile.is_open())
+            return false;
+        data.assign(std::istreambuf_iterator<char>(cacheFile), std::istreambuf_iterator<char>());
+    }
+    catch (utils::error const &e)
+    {
+        return false;
+    }
+
+    const std::string &header = expected.data();
+    if ((data.size() < header.size()) || (data.compare(0, header.size(), header) != 0))
+        return false;
+
+    data.erase(0, header.size());
+    cacheReader reader(data);
+    transfer(reader);
+    if (!reader.valid())
+    {
+        clear();
+        return false;
+    }
+
+    debug("Config loaded from cache: ", configPath.c_str());
+    return true;
+}
+
+void IniConfig::saveCache(const std::string &configPath)
+{
+    cacheWriter writer;
+    if (!cacheHeader(writer, configPath))
+        return;
+    transfer(writer);
+
+    try
+    {
+        // Replace atomically, other instances may be reading it
+        const std::string cacheFile = getCacheFile();
+        const std::string tempFile = utils::tempName(cacheFile);
+        {
+            fs::ofstream out(tempFile, std::ios::binary | std::ios::trunc);
+            out.write(writer.data().data(), writer.data().size());
+            if (out.fail())
+                return;
+        }
+        std::error_code ec;
+        fs::rename(tempFile, cacheFile, ec);
+        if (ec)
+            fs::remove(tempFile, ec);
     }
+    catch (utils::error const &e) {}
+}
+
+void IniConfig::read()
+{
+    clear();
 
-    readSidplay2  (ini);
-    readConsole   (ini);
-    readAudio     (ini);
-    readEmulation (ini);
+    std::string configPath;
+    try
+    {
+        configPath = findConfigFile();
+    }
+    catch (iniError const &e)
+    {
+        error(e.message().c_str());
+        return;
+    }
+
+    if (!loadCache(configPath))
+    {
+        iniHandler ini;
+
+        // Opens an existing file or creates a new one
+        if (!ini.open(configPath.c_str()))
+        {
+            error("Error reading config file!");
+            return;
+        }
+
+        readSidplay2  (ini);
+        readConsole   (ini);
+        readAudio     (ini);
+        readEmulation (ini);
+
+        // Missing keys are written back
+        ini.close();
+
+        saveCache(configPath);
+    }
 
-    m_fileName = ini.getFilename();
+    m_fileName = configPath;
 
-    ini.close();
+    findDatabase();
 }
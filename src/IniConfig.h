@@ -44,6 +44,8 @@ public:
         std::string     database;
         uint_least32_t playLength;
         uint_least32_t recordLength;
+        uint_least32_t endDetectTime;
+        int            renderCacheSize; // MB, 0 disables the cache
         std::string     kernalRom;
         std::string     basicRom;
         std::string     chargenRom;
@@ -78,6 +80,12 @@ public:
         int channels;  // number of channels
         int precision; // sample precision in bits
         int bufLength; // buffer length in milliseconds
+        double panning[3]; // stereo position of each chip
+        int queueDepth; // buffers queued by streaming outputs
+        int rtPriority; // real time priority of the playback thread, 0 is off
+        bool rtRoundRobin; // SCHED_RR instead of SCHED_FIFO
+        int cpuAffinity; // processor for the playback thread, -1 is any
+        bool lockMemory; // lock the process memory
         int getBufSize() const { return (bufLength * frequency) / 1000; }
     };
 
@@ -106,6 +114,9 @@ public:
         int           powerOnDelay;
         SidConfig::sampling_method_t  samplingMethod;
         bool          fastSampling;
+        int           playChunk;   // cycles to emulate at once when playing
+        int           recordChunk; // cycles to emulate at once when recording
+        bool          autoFallback; // switch to a cheaper emulation if too slow
     };
 
 protected:
@@ -122,9 +133,18 @@ protected:
     void readAudio     (iniHandler &ini);
     void readEmulation (iniHandler &ini);
 
+    void findDatabase  ();
+
 private:
     std::string m_fileName;
 
+private:
+    template<class T>
+    void transfer (T &archive);
+
+    bool loadCache (const std::string &configPath);
+    void saveCache (const std::string &configPath);
+
 public:
     IniConfig  ();
     ~IniConfig ();
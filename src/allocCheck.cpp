@@ -0,0 +1,110 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "allocCheck.h"
+
+#ifndef NDEBUG
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<bool> armed(false);
+static std::atomic<bool> counting(false);
+static std::atomic<unsigned long> allocationCount(0);
+static std::atomic<unsigned long> armCount(0);
+
+void allocCheck::arm()
+{
+    armCount.fetch_add(1, std::memory_order_relaxed);
+    armed.store(true);
+}
+
+void allocCheck::disarm() { armed.store(false); }
+
+void allocCheck::countOnly() { counting.store(true); }
+
+unsigned long allocCheck::allocations() { return allocationCount.load(); }
+
+unsigned long allocCheck::armings() { return armCount.load(); }
+
+static void *allocate(std::size_t size)
+{
+    if (armed.load(std::memory_order_relaxed))
+    {
+        if (counting.load(std::memory_order_relaxed))
+        {
+            allocationCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            // Don't come back here while reporting
+            armed.store(false);
+            std::fprintf(stderr, "\nERROR: %lu bytes allocated during playback\n",
+                static_cast<unsigned long>(size));
+            std::abort();
+        }
+    }
+
+    if (size == 0)
+        size = 1;
+
+    for (;;)
+    {
+        void *p = std::malloc(size);
+        if (p != nullptr)
+            return p;
+
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+static void *allocate(std::size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return allocate(size);
+    }
+    catch (std::bad_alloc const &)
+    {
+        return nullptr;
+    }
+}
+
+// Replace the global allocation functions, the aligned
+// variants keep the library implementation
+
+void *operator new(std::size_t size) { return allocate(size); }
+void *operator new[](std::size_t size) { return allocate(size); }
+void *operator new(std::size_t size, const std::nothrow_t &tag) noexcept { return allocate(size, tag); }
+void *operator new[](std::size_t size, const std::nothrow_t &tag) noexcept { return allocate(size, tag); }
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void *p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+#endif
@@ -0,0 +1,78 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef ALLOCCHECK_H
+#define ALLOCCHECK_H
+
+/**
+ * Catch heap allocations in code that must not allocate,
+ * such as the steady state of the play loop.
+ *
+ * While armed, any call to the global operator new, from any
+ * thread, prints the requested size and aborts, so a debugger
+ * or a core dump points straight at the culprit.
+ * Only debug builds replace the allocator, in release builds
+ * these are no-ops.
+ *
+ * Loop detection keeps a history growing with the song, as does
+ * the loudness measurement when the length is not known, so the
+ * player doesn't arm the check while they run.
+ */
+namespace allocCheck
+{
+#ifndef NDEBUG
+void arm();
+void disarm();
+
+/**
+ * Count the allocations instead of aborting,
+ * so that a test can go through all its cases.
+ */
+void countOnly();
+
+/// Allocations made while armed, in count only mode.
+unsigned long allocations();
+
+/// Times the check has been armed.
+unsigned long armings();
+#else
+inline void arm() {}
+inline void disarm() {}
+#endif
+
+/**
+ * Disarm the check when leaving the scope,
+ * covers the early returns.
+ */
+class scope
+{
+private:
+    bool m_armed;
+
+public:
+    scope() : m_armed(false) {}
+    ~scope() { disarm(); }
+
+    void arm() { m_armed = true; allocCheck::arm(); }
+    void disarm() { if (m_armed) { m_armed = false; allocCheck::disarm(); } }
+};
+}
+
+#endif // ALLOCCHECK_H
@@ -152,11 +152,15 @@ bool parseAddress(const char *str, uint_least16_t &address)
 void displayDebugArgs()
 {
     fmt::print("Debug Options:\n"
+#ifndef NDEBUG
+        " --alloc-check abort on heap allocations during playback\n"
+#endif
         " --cpu-debug   display cpu register and assembly dumps\n"
         " --delay=<num> simulate c64 power on delay (default: random)\n"
         " --noaudio     no audio output device\n"
         " --nosid       no sid emulation\n"
-        " --none        no audio output device and no sid emulation\n");
+        " --none        no audio output device and no sid emulation\n"
+        " --startup-profile print the time spent in each startup phase\n");
 }
 
 // Parse command line arguments
@@ -238,6 +242,44 @@ int ConsolePlayer::args(int argc, const char *argv[])
                 }
                 m_fadeoutTime = static_cast<uint_least32_t>(fadeoutTime);
             }
+            else if (std::strncmp (&argv[i][1], "-chunk=", 7) == 0)
+            {
+                char *end;
+                const long cycles = std::strtol(&argv[i][8], &end, 10);
+                if ((end == &argv[i][8]) || (*end != '\0')
+                    || (cycles < MIN_CYCLES) || (cycles > MAX_CYCLES))
+                    err = true;
+                m_chunk = static_cast<int>(cycles);
+            }
+            else if (std::strncmp (&argv[i][1], "-pan=", 5) == 0)
+            {
+                // Comma separated list of positions, one per chip
+                const char *pan = &argv[i][6];
+                for (int chip=0; ; chip++)
+                {
+                    if (chip == 3)
+                    {   // More positions than chips
+                        err = true;
+                        break;
+                    }
+                    char *end;
+                    const double value = std::strtod(pan, &end);
+                    if ((end == pan) || (value < 0.) || (value > 1.))
+                    {
+                        err = true;
+                        break;
+                    }
+                    m_panning[chip] = value;
+                    if (*end == '\0')
+                        break;
+                    if (*end != ',')
+                    {
+                        err = true;
+                        break;
+                    }
+                    pan = end + 1;
+                }
+            }
 #endif
             else if (argv[i][1] == 'f')
             {
@@ -325,6 +367,66 @@ int ConsolePlayer::args(int argc, const char *argv[])
                     m_quietLevel = std::atoi(&argv[i][2]);
             }
 
+#if defined(FEAT_NEW_PLAY_API) && defined(FEAT_REGS_DUMP_SID)
+            else if (std::strcmp (&argv[i][1], "-single-loop") == 0)
+            {
+                m_singleLoop = true;
+            }
+#endif
+            else if (std::strcmp (&argv[i][1], "-loudness") == 0)
+            {
+                m_measureLoudness = true;
+            }
+            else if (std::strncmp (&argv[i][1], "-end-detect=", 12) == 0)
+            {
+                uint_least32_t time;
+                if (!parseTime (&argv[i][13], time))
+                    err = true;
+                m_endDetectTime = time;
+            }
+            else if (std::strncmp (&argv[i][1], "-cache=", 7) == 0)
+            {
+                char *end;
+                const long size = std::strtol(&argv[i][8], &end, 10);
+                if ((end == &argv[i][8]) || (*end != '\0')
+                    || (size < 0) || (size > INT_MAX))
+                    err = true;
+                m_cacheSize = static_cast<int>(size);
+            }
+            else if (std::strncmp (&argv[i][1], "-rt-priority=", 13) == 0)
+            {
+                char *end;
+                const long priority = std::strtol(&argv[i][14], &end, 10);
+                if ((end == &argv[i][14]) || (*end != '\0')
+                    || (priority < 0) || (priority > INT_MAX))
+                    err = true;
+                m_rtPriority = static_cast<int>(priority);
+            }
+            else if (std::strcmp (&argv[i][1], "-rt-policy=fifo") == 0)
+            {
+                m_rtRoundRobin = false;
+            }
+            else if (std::strcmp (&argv[i][1], "-rt-policy=rr") == 0)
+            {
+                m_rtRoundRobin = true;
+            }
+            else if (std::strncmp (&argv[i][1], "-cpu-affinity=", 14) == 0)
+            {
+                char *end;
+                const long cpu = std::strtol(&argv[i][15], &end, 10);
+                if ((end == &argv[i][15]) || (*end != '\0')
+                    || (cpu < 0) || (cpu > INT_MAX))
+                    err = true;
+                m_cpuAffinity = static_cast<int>(cpu);
+            }
+            else if (std::strcmp (&argv[i][1], "-lock-memory") == 0)
+            {
+                m_lockMemory = true;
+            }
+            else if (std::strcmp (&argv[i][1], "-auto-fallback") == 0)
+            {
+                m_autoFallback = true;
+            }
             else if (argv[i][1] == 't')
             {
                 if (!parseTime (&argv[i][2], m_timer.length))
@@ -489,6 +591,20 @@ int ConsolePlayer::args(int argc, const char *argv[])
                 if (argv[i][4] != '\0')
                     m_outfile = &argv[i][4];
             }
+            else if (std::strncmp (&argv[i][1], "-raw", 4) == 0)
+            {
+                m_driver.output = output_t::RAW;
+                m_driver.file   = true;
+                if (argv[i][5] != '\0')
+                    m_outfile = &argv[i][5];
+            }
+            else if (std::strncmp (&argv[i][1], "-flac", 5) == 0)
+            {
+                m_driver.output = output_t::FLAC;
+                m_driver.file   = true;
+                if (argv[i][6] != '\0')
+                    m_outfile = &argv[i][6];
+            }
             else if (std::strncmp (&argv[i][1], "-info", 5) == 0)
             {
                 m_driver.info   = true;
@@ -557,6 +673,16 @@ int ConsolePlayer::args(int argc, const char *argv[])
             {
                 m_cpudebug = true;
             }
+            else if (std::strcmp (&argv[i][1], "-startup-profile") == 0)
+            {
+                m_startupProfile = true;
+            }
+#ifndef NDEBUG
+            else if (std::strcmp (&argv[i][1], "-alloc-check") == 0)
+            {
+                m_allocCheck = true;
+            }
+#endif
 
             else
             {
@@ -600,6 +726,7 @@ int ConsolePlayer::args(int argc, const char *argv[])
             return -1;
         }
     }
+    m_profile.mark("tune load");
 
     // If filename specified we can only convert one song
     if (m_outfile != nullptr)
@@ -617,9 +744,15 @@ int ConsolePlayer::args(int argc, const char *argv[])
         return -1;
     }
 
-    if (m_driver.info && m_driver.file)
+    if (m_driver.info && m_driver.file
+        && (m_driver.output != output_t::WAV) && (m_driver.output != output_t::FLAC))
+    {
+        displayError ("WARNING: metadata can be added only to wav and flac files");
+    }
+
+    if (m_singleLoop && m_driver.file && (m_driver.output != output_t::WAV))
     {
-        displayError ("WARNING: metadata can be added only to wav files");
+        displayError ("WARNING: loop points can be stored only in wav files");
     }
 
     // Select the desired track
@@ -690,6 +823,7 @@ int ConsolePlayer::args(int argc, const char *argv[])
             }
         }
     }
+    m_profile.mark("songlength database");
 
 #if HAVE_TSID == 1
     // Set TSIDs base directory
@@ -700,12 +834,26 @@ int ConsolePlayer::args(int argc, const char *argv[])
     }
 #endif
 
-    // Configure engine with settings
-    if (!m_engine.config (m_engCfg))
-    {   // Config failed
-        displayError (m_engine.error ());
-        return -1;
+    // Rendered songs are reused only when writing files
+    const int cacheSize = m_cacheSize.has_value()
+        ? m_cacheSize.value()
+        : (m_iniCfg.sidplay2()).renderCacheSize;
+    if (m_driver.file && (cacheSize > 0))
+    {
+        try
+        {
+            std::string cacheDir(utils::getCachePath());
+            cacheDir.append(SEPARATOR).append("sidplayfp").append(SEPARATOR).append("render");
+            m_cache.setup(cacheDir, static_cast<uint_least64_t>(cacheSize) * 1024 * 1024);
+        }
+        catch (utils::error const &e)
+        {
+            displayError ("WARNING: Cannot get cache path, render cache disabled");
+        }
     }
+
+    // The engine is configured when the tune is opened
+    m_profile.mark("options");
     return 1;
 }
 
@@ -743,8 +891,27 @@ void ConsolePlayer::displayArgs(const char *arg)
 
         " -s           force stereo output\n"
         " -m           force mono output\n"
+#ifdef FEAT_NEW_PLAY_API
+        " --pan=<num>[,<num>[,<num>]] set the stereo position of each chip\n"
+        "              from 0.0 (left) to 1.0 (right)\n"
+        " --chunk=<num> set the number of cycles to emulate at once\n"
+        "              (default: 2000 for playback, 20000 for file output)\n"
+#endif
 
         " -t<num>      set play length in [mins:]secs[.milli] format (0 is endless)\n"
+        " --end-detect=<num> stop songs of unknown length after <num> of\n"
+        "              silence or inactivity, [mins:]secs[.milli] format (0 is off)\n"
+#if defined(FEAT_NEW_PLAY_API) && defined(FEAT_REGS_DUMP_SID)
+        " --single-loop stop at the end of the first loop and mark it in wav files\n"
+#endif
+        " --cache=<num> reuse rendered songs from a cache of at most <num> MB\n"
+        "              when writing files (0 is off)\n"
+        " --rt-priority=<num> play with real time priority <num> (0 is off)\n"
+        " --rt-policy=<fifo|rr> real time scheduling policy (default: fifo)\n"
+        " --cpu-affinity=<num> run the emulation on processor <num>\n"
+        " --lock-memory lock the memory of the player to prevent paging\n"
+        " --auto-fallback switch to a cheaper emulation if playback\n"
+        "              can't keep up with real time\n"
 
         " -<v|q>[x]    verbose or quiet output. x is the optional level, default=1\n"
         " -v[p|n][f]   set VIC PAL/NTSC clock speed (default: defined by song)\n"
@@ -755,7 +922,11 @@ void ConsolePlayer::displayArgs(const char *arg)
         " --digiboost  Enable digiboost for 8580 model\n"
         " -w[name]     create wav file (default: <datafile>[n].wav)\n"
         " --au[name]   create au file (default: <datafile>[n].au)\n"
-        " --info       add metadata to wav file\n"
+        " --flac[name] create flac file (default: <datafile>[n].flac)\n"
+        " --raw[name]  create headerless pcm file (default: <datafile>[n].raw)\n"
+        " --info       add metadata to wav and flac files\n"
+        " --loudness   measure the loudness of the output, ReplayGain\n"
+        "              values are added to wav and flac files\n"
 
 #ifdef HAVE_SIDPLAYFP_BUILDERS_RESIDFP_H
         " --residfp    use reSIDfp emulation (default)\n"
@@ -70,6 +70,16 @@ public:
 
     short *buffer() const override { return m_sampleBuffer; }
 
+    bool discard() const override { return false; }
+
+    void setLength(uint_least32_t) override {}
+
+    bool setLoop(uint_least64_t, uint_least64_t) override { return false; }
+
+    bool setEnd(uint_least64_t) override { return false; }
+
+    void setReplayGain(double, double) override {}
+
     void clearBuffer() override { std::memset(m_sampleBuffer, 0, m_settings.getBufBytes()); }
 
     void getConfig(AudioConfig &cfg) const override
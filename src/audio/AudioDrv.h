@@ -41,6 +41,11 @@ public:
     void close() override { audio->close(); }
     void pause() override { audio->pause(); }
     short *buffer() const override { return audio->buffer(); }
+    bool discard() const override { return audio->discard(); }
+    void setLength(uint_least32_t ms) override { audio->setLength(ms); }
+    bool setLoop(uint_least64_t start, uint_least64_t end) override { return audio->setLoop(start, end); }
+    bool setEnd(uint_least64_t frames) override { return audio->setEnd(frames); }
+    void setReplayGain(double gain, double peak) override { audio->setReplayGain(gain, peak); }
     void clearBuffer() override { audio->clearBuffer(); }
     void getConfig(AudioConfig &cfg) const override { audio->getConfig(cfg); }
     const char *getErrorString() const override { return audio->getErrorString(); }
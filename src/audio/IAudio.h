@@ -37,6 +37,16 @@ public:
     virtual void close() = 0;
     virtual void pause() = 0;
     virtual short *buffer() const = 0;
+    /// Output is thrown away, no need to produce samples
+    virtual bool discard() const = 0;
+    /// Expected length of the output in milliseconds
+    virtual void setLength(uint_least32_t ms) = 0;
+    /// Mark a loop in frames and drop the output past its end, false if not supported
+    virtual bool setLoop(uint_least64_t start, uint_least64_t end) = 0;
+    /// Drop the output past the given frame, false if not supported
+    virtual bool setEnd(uint_least64_t frames) = 0;
+    /// Track gain in dB and peak relative to full scale, stored as metadata if supported
+    virtual void setReplayGain(double gain, double peak) = 0;
     virtual void clearBuffer() = 0;
     virtual void getConfig(AudioConfig &cfg) const = 0;
     virtual const char *getErrorString() const = 0;
@@ -0,0 +1,165 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "asyncWriter.h"
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "sidcxx11.h"
+
+#if defined(HAVE_FALLOCATE) || defined(HAVE_TRUNCATE)
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+asyncWriter::asyncWriter(std::ostream &file, convert_t convert, unsigned int depth, std::size_t bufBytes) :
+    m_file(file),
+    m_convert(convert),
+    m_buffers(depth + 1, std::vector<char>(bufBytes)),
+    m_samples(depth + 1),
+    m_head(0),
+    m_tail(0),
+    m_writerWaiting(false),
+    m_producerWaiting(false),
+    m_failed(false),
+    m_quit(false)
+{
+    m_thread = std::thread(&asyncWriter::run, this);
+}
+
+asyncWriter::~asyncWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit.store(true);
+    }
+    m_writeCond.notify_one();
+    m_thread.join();
+}
+
+/*
+ * The indexes are only stored by one side, the mutex is used
+ * just to sleep when there is nothing to do. The waiting flag
+ * is raised before checking the index again, and the other side
+ * checks it after publishing the index, so at least one of the
+ * two sees the change and no wakeup is lost.
+ */
+void asyncWriter::waitForData()
+{
+    if (m_head.load(std::memory_order_relaxed) != m_tail.load(std::memory_order_acquire))
+        return;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_writerWaiting.store(true);
+    m_writeCond.wait(lock, [this] {
+        return m_quit.load() || (m_head.load(std::memory_order_relaxed) != m_tail.load()); });
+    m_writerWaiting.store(false);
+}
+
+void asyncWriter::waitForSpace(unsigned int pending)
+{
+    auto ready = [this, pending] {
+        return (m_tail.load(std::memory_order_relaxed) - m_head.load()) <= pending; };
+
+    if (ready())
+        return;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_producerWaiting.store(true);
+    m_freeCond.wait(lock, ready);
+    m_producerWaiting.store(false);
+}
+
+void asyncWriter::run()
+{
+    for (;;)
+    {
+        waitForData();
+
+        const unsigned int head = m_head.load(std::memory_order_relaxed);
+        // Drain the queue before quitting
+        if (head == m_tail.load(std::memory_order_acquire))
+            return;
+
+        const unsigned int index = head % m_buffers.size();
+        if (!m_failed.load(std::memory_order_relaxed))
+        {
+            char *buffer = m_buffers[index].data();
+            const std::size_t bytes = m_convert(buffer, m_samples[index]);
+            m_file.write(buffer, bytes);
+            if (m_file.fail())
+                m_failed.store(true, std::memory_order_relaxed);
+        }
+
+        m_head.store(head + 1);
+        if (m_producerWaiting.load())
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_freeCond.notify_one();
+        }
+    }
+}
+
+void asyncWriter::submit(std::size_t samples)
+{
+    const unsigned int tail = m_tail.load(std::memory_order_relaxed);
+    m_samples[tail % m_buffers.size()] = samples;
+    m_tail.store(tail + 1);
+
+    if (m_writerWaiting.load())
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_writeCond.notify_one();
+    }
+
+    // The next buffer is free once the writer is done with it
+    waitForSpace(m_buffers.size() - 1);
+}
+
+void asyncWriter::flush()
+{
+    waitForSpace(0);
+}
+
+bool preallocateFile(MAYBE_UNUSED const std::string &name, MAYBE_UNUSED uint_least64_t bytes)
+{
+#if defined(HAVE_FALLOCATE) && defined(FALLOC_FL_KEEP_SIZE)
+    const int fd = ::open(name.c_str(), O_WRONLY);
+    if (fd < 0)
+        return false;
+    // Keep the size unchanged so the stream keeps appending
+    const bool ok = fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, bytes) == 0;
+    ::close(fd);
+    return ok;
+#else
+    return false;
+#endif
+}
+
+bool truncateFile(MAYBE_UNUSED const std::string &name, MAYBE_UNUSED uint_least64_t bytes)
+{
+#ifdef HAVE_TRUNCATE
+    return ::truncate(name.c_str(), bytes) == 0;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,112 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef ASYNCWRITER_H
+#define ASYNCWRITER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cstddef>
+#include <stdint.h>
+
+/*
+ * Convert and write buffers to a stream from a dedicated thread.
+ *
+ * A fixed ring of buffers is recycled: the caller fills
+ * the current buffer with 16 bit samples and submits it,
+ * then continues with the next one, waiting only if the
+ * writer is more than depth buffers behind.
+ * The ring is a single producer single consumer queue
+ * which doesn't lock unless one side has to wait.
+ */
+class asyncWriter
+{
+public:
+    /// Convert samples in place, returns the number of bytes to write
+    typedef std::size_t (*convert_t)(char *buffer, std::size_t samples);
+
+private:
+    std::ostream &m_file;
+    const convert_t m_convert;
+
+    std::vector<std::vector<char>> m_buffers;
+    std::vector<std::size_t> m_samples;
+
+    // Free running counters, the caller owns the buffer
+    // at m_tail and the ones from m_head are queued
+    std::atomic<unsigned int> m_head;
+    std::atomic<unsigned int> m_tail;
+
+    std::atomic<bool> m_writerWaiting;
+    std::atomic<bool> m_producerWaiting;
+    std::atomic<bool> m_failed;
+    std::atomic<bool> m_quit;
+
+    std::mutex m_mutex;
+    std::condition_variable m_writeCond;
+    std::condition_variable m_freeCond;
+    std::thread m_thread;
+
+private:
+    void run();
+    void waitForData();
+    void waitForSpace(unsigned int pending);
+
+public:
+    /**
+     * @throw std::bad_alloc
+     * @throw std::system_error if the thread cannot be started
+     */
+    asyncWriter(std::ostream &file, convert_t convert, unsigned int depth, std::size_t bufBytes);
+    ~asyncWriter();
+
+    /// The buffer to fill, changes after each submit.
+    char *buffer() { return m_buffers[m_tail.load(std::memory_order_relaxed) % m_buffers.size()].data(); }
+
+    /// Queue the current buffer for conversion and writing.
+    void submit(std::size_t samples);
+
+    /// Wait until all the queued buffers are written.
+    void flush();
+
+    /// A write to the stream has failed.
+    bool failed() const { return m_failed.load(std::memory_order_relaxed); }
+};
+
+/**
+ * Reserve disk space for a file of the expected size without
+ * changing its length, if supported by the platform.
+ *
+ * @return true if the space has been reserved
+ */
+bool preallocateFile(const std::string &name, uint_least64_t bytes);
+
+/**
+ * Set the file length, releasing any space reserved past it.
+ */
+bool truncateFile(const std::string &name, uint_least64_t bytes);
+
+#endif // ASYNCWRITER_H
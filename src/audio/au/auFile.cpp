@@ -27,6 +27,9 @@
 #include <iomanip>
 #include <fstream>
 #include <new>
+#include <system_error>
+
+#include <cstring>
 
 /// Set the lo byte (8 bit) in a word (16 bit)
 inline void endian_16lo8 (uint_least16_t &word, uint8_t byte)
@@ -169,6 +172,32 @@ inline void endian_big32 (uint8_t ptr[4], uint_least32_t dword)
     ptr[3] = endian_32lo8 (dword);
 }
 
+// Convert in place to big endian
+static std::size_t convert16(char *buffer, std::size_t samples)
+{
+    const short *in = (const short*)buffer;
+    for (std::size_t i=0; i<samples; i++)
+    {
+        endian_big16((uint8_t*)buffer + i*2, in[i]);
+    }
+    return samples * 2;
+}
+
+// normalize floats, starting from the end
+// so that only already converted samples are overwritten
+static std::size_t convertFloat(char *buffer, std::size_t samples)
+{
+    const short *in = (const short*)buffer;
+    for (std::size_t i=samples; i-- > 0; )
+    {
+        const float temp = ((float)in[i])/32768.f;
+        uint_least32_t dword;
+        std::memcpy(&dword, &temp, 4);
+        endian_big32((uint8_t*)buffer + i*4, dword);
+    }
+    return samples * 4;
+}
+
 const auHeader auFile::defaultAuHdr =
 {
     // ASCII keywords are hexified.
@@ -180,12 +209,16 @@ const auHeader auFile::defaultAuHdr =
     {0,0,0,0},             // Channels
 };
 
-auFile::auFile(const std::string &name) :
+auFile::auFile(const std::string &name, unsigned int queueDepth) :
     AudioBase("AUFILE"),
     name(name),
     auHdr(defaultAuHdr),
     file(nullptr),
+    m_writer(nullptr),
+    m_queueDepth(queueDepth ? queueDepth : 1),
+    m_preallocated(false),
     headerWritten(false),
+    hasEnd(false),
     m_precision(32)
 {}
 
@@ -205,21 +238,13 @@ bool auFile::open(AudioConfig &cfg)
     if (name.empty())
         return false;
 
-    if (file && !file->fail())
+    if (file)
         close();
 
     byteCount = 0;
-
-    // We need to make a buffer for the user
-    try
-    {
-        m_sampleBuffer = new short[bufSize/2];
-    }
-    catch (std::bad_alloc const &ba)
-    {
-        setError("Unable to allocate memory for sample buffers.");
-        return false;
-    }
+    headerWritten = false;
+    m_preallocated = false;
+    hasEnd = false;
 
     // Fill in header with parameters and expected file size.
     endian_big32(auHdr.encoding, format);
@@ -233,15 +258,46 @@ bool auFile::open(AudioConfig &cfg)
     else
     {
         file = new std::ofstream(name.c_str(), std::ios::out|std::ios::binary|std::ios::trunc);
+        if (file->fail())
+        {
+            setError("Unable to open output file.");
+            delete file;
+            file = nullptr;
+            return false;
+        }
     }
 
+    auto fail = [this](const char *msg)
+    {
+        setError(msg);
+        if (file != &std::cout)
+            delete file;
+        file = nullptr;
+        return false;
+    };
+
+    // The writer buffers are handed to the user
+    try
+    {
+        m_writer = new asyncWriter(*file, (m_precision == 16) ? convert16 : convertFloat, m_queueDepth, bufSize);
+    }
+    catch (std::bad_alloc const &ba)
+    {
+        return fail("Unable to allocate memory for sample buffers.");
+    }
+    catch (std::system_error const &e)
+    {
+        return fail("Unable to start writer thread.");
+    }
+    m_sampleBuffer = reinterpret_cast<short*>(m_writer->buffer());
+
     m_settings = cfg;
     return true;
 }
 
 bool auFile::write(uint_least32_t frames)
 {
-    if (file && !file->fail())
+    if (m_writer && !m_writer->failed())
     {
         uint_least32_t size = frames * m_channels;
         unsigned long int bytes = size;
@@ -251,29 +307,10 @@ bool auFile::write(uint_least32_t frames)
             headerWritten = true;
         }
 
-        if (m_precision == 16)
-        {
-            std::vector<uint_least16_t> buffer(size);
-            bytes *= 2;
-            for (unsigned long i=0; i<size; i++)
-            {
-                uint_least16_t temp = m_sampleBuffer[i];
-                buffer[i] = endian_big16((uint8_t*)&temp);
-            }
-            file->write((char*)&buffer.front(), bytes);
-        }
-        else
-        {
-            std::vector<float> buffer(size);
-            bytes *= 4;
-            // normalize floats
-            for (unsigned long i=0; i<size; i++)
-            {
-                float temp = ((float)m_sampleBuffer[i])/32768.f;
-                buffer[i] = endian_big32((uint8_t*)&temp);
-            }
-            file->write((char*)&buffer.front(), bytes);
-        }
+        // Conversion is done by the writer thread
+        bytes *= (m_precision == 16) ? 2 : 4;
+        m_writer->submit(size);
+        m_sampleBuffer = reinterpret_cast<short*>(m_writer->buffer());
         byteCount += bytes;
 
     }
@@ -282,8 +319,22 @@ bool auFile::write(uint_least32_t frames)
 
 void auFile::close()
 {
+    if (m_writer)
+    {
+        m_writer->flush();
+        delete m_writer;
+        m_writer = nullptr;
+        m_sampleBuffer = nullptr;
+    }
+
     if (file && !file->fail())
     {
+        // cut the data at the end of the song
+        const unsigned long int blockAlign = m_channels * (m_precision / 8);
+        const bool cut = hasEnd && (file != &std::cout) && (endFrame * blockAlign < byteCount);
+        if (cut)
+            byteCount = endFrame * blockAlign;
+
         // update length field in header
         endian_big32(auHdr.dataSize, byteCount);
         if (file != &std::cout)
@@ -291,8 +342,35 @@ void auFile::close()
             file->seekp(0, std::ios::beg);
             file->write((char*)&auHdr, sizeof(auHeader));
             delete file;
+
+            // release the space reserved past the end
+            if (m_preallocated || cut)
+                truncateFile(name, sizeof(auHeader)+byteCount);
         }
         file = nullptr;
-        delete[] m_sampleBuffer;
     }
+    else if (file && (file != &std::cout))
+    {
+        delete file;
+        file = nullptr;
+    }
+}
+
+void auFile::setLength(uint_least32_t ms)
+{
+    if (!file || (file == &std::cout))
+        return;
+
+    const uint_least64_t bytesPerSec = m_settings.frequency * m_settings.channels * (m_precision / 8);
+    m_preallocated = preallocateFile(name, sizeof(auHeader) + (bytesPerSec * ms) / 1000);
+}
+
+bool auFile::setEnd(uint_least64_t frames)
+{
+    if (!file || (file == &std::cout))
+        return false;
+
+    hasEnd = true;
+    endFrame = frames;
+    return true;
 }
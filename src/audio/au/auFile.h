@@ -28,6 +28,7 @@
 #include <string>
 
 #include "../AudioBase.h"
+#include "../asyncWriter.h"
 
 struct auHeader                         // little endian format
 {
@@ -56,12 +57,17 @@ private:
     auHeader auHdr;
 
     std::ostream *file;
+    asyncWriter *m_writer;
+    unsigned int m_queueDepth;
+    bool m_preallocated;
     bool headerWritten;
+    bool hasEnd;
+    uint_least64_t endFrame;
     int m_precision;
     int m_channels;
 
 public:
-    explicit auFile(const std::string &name);
+    auFile(const std::string &name, unsigned int queueDepth);
     ~auFile() override { close(); }
 
     static const char *extension () { return ".au"; }
@@ -78,6 +84,12 @@ public:
     void pause() override {}
     void reset() override {}
 
+    // Reserve disk space for the given length.
+    void setLength(uint_least32_t ms) override;
+
+    // Drop the data past the end of the song.
+    bool setEnd(uint_least64_t frames) override;
+
     // Stream state.
     bool fail() const { return (file->fail() != 0); }
     bool bad()  const { return (file->bad()  != 0); }
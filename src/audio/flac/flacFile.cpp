@@ -0,0 +1,959 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "flacFile.h"
+
+#include "../asyncWriter.h"
+
+#include <algorithm>
+#include <fstream>
+#include <new>
+#include <system_error>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+namespace
+{
+
+// Samples per frame
+constexpr uint_least32_t BLOCK_SIZE = 4096;
+
+constexpr unsigned int MAX_ORDER = 4;
+constexpr unsigned int MAX_PARTITION_ORDER = 8;
+constexpr unsigned int MAX_RICE_PARAM = 14;
+
+constexpr unsigned int MAX_WORKERS = 8;
+
+// Start offsets of the last frames written, the output
+// can be cut back at most this far, about three minutes
+// at 48kHz
+constexpr unsigned int FRAME_HISTORY = 2048;
+
+// Channel assignments
+constexpr unsigned int CH_INDEPENDENT = 0;
+constexpr unsigned int CH_LEFT_SIDE = 8;
+constexpr unsigned int CH_RIGHT_SIDE = 9;
+constexpr unsigned int CH_MID_SIDE = 10;
+
+const char VENDOR[] = "sidplayfp";
+
+// Padding after the comments, room for the ReplayGain
+// values which are known only at the end
+constexpr uint_least32_t REPLAYGAIN_SPACE = 128;
+
+struct crcTables
+{
+    uint8_t crc8[256];
+    uint16_t crc16[256];
+
+    crcTables()
+    {
+        for (unsigned int i = 0; i < 256; i++)
+        {
+            unsigned int c8 = i;
+            unsigned int c16 = i << 8;
+            for (unsigned int j = 0; j < 8; j++)
+            {
+                c8 = (c8 & 0x80) ? ((c8 << 1) ^ 0x07) : (c8 << 1);
+                c16 = (c16 & 0x8000) ? ((c16 << 1) ^ 0x8005) : (c16 << 1);
+            }
+            crc8[i] = static_cast<uint8_t>(c8);
+            crc16[i] = static_cast<uint16_t>(c16);
+        }
+    }
+};
+
+const crcTables tables;
+
+uint8_t crc8(const uint8_t* data, std::size_t length)
+{
+    uint8_t crc = 0;
+    for (std::size_t i = 0; i < length; i++)
+        crc = tables.crc8[crc ^ data[i]];
+    return crc;
+}
+
+uint16_t crc16(const uint8_t* data, std::size_t length)
+{
+    uint16_t crc = 0;
+    for (std::size_t i = 0; i < length; i++)
+        crc = static_cast<uint16_t>((crc << 8) ^ tables.crc16[(crc >> 8) ^ data[i]]);
+    return crc;
+}
+
+/*
+ * MSB first bit writer
+ */
+class bitWriter
+{
+private:
+    std::vector<uint8_t> &m_data;
+    uint_least64_t m_acc;
+    unsigned int m_bits;
+
+public:
+    explicit bitWriter(std::vector<uint8_t> &data) :
+        m_data(data),
+        m_acc(0),
+        m_bits(0)
+    {
+        m_data.clear();
+    }
+
+    // write up to 32 bits
+    void put(uint_least32_t value, unsigned int bits)
+    {
+        m_acc = (m_acc << bits) | (value & ((UINT64_C(1) << bits) - 1));
+        m_bits += bits;
+        while (m_bits >= 8)
+        {
+            m_bits -= 8;
+            m_data.push_back(static_cast<uint8_t>(m_acc >> m_bits));
+        }
+    }
+
+    void putSigned(int_least32_t value, unsigned int bits)
+    {
+        put(static_cast<uint_least32_t>(value), bits);
+    }
+
+    void putRice(uint_least32_t value, unsigned int param)
+    {
+        uint_least32_t q = value >> param;
+        while (q >= 32)
+        {
+            put(0, 32);
+            q -= 32;
+        }
+        if (q + 1 + param <= 32)
+        {
+            // unary quotient, stop bit and remainder at once
+            put((UINT32_C(1) << param) | (value & ((UINT32_C(1) << param) - 1)), q + 1 + param);
+        }
+        else
+        {
+            put(1, q + 1);
+            put(value, param);
+        }
+    }
+
+    void align()
+    {
+        if (m_bits)
+            put(0, 8 - m_bits);
+    }
+
+    std::size_t size() const { return m_data.size(); }
+};
+
+inline uint_least32_t zigzag(int_least32_t value)
+{
+    return (static_cast<uint_least32_t>(value) << 1) ^ static_cast<uint_least32_t>(value >> 31);
+}
+
+/*
+ * Compute the sum of absolute residuals for all the fixed predictor orders
+ * and return the best one.
+ */
+unsigned int bestOrder(const int_least32_t* x, uint_least32_t n, uint_least64_t &bits)
+{
+    if (n <= MAX_ORDER)
+    {
+        bits = UINT64_MAX;
+        return 0;
+    }
+
+    uint_least64_t sum[MAX_ORDER + 1] = { 0, 0, 0, 0, 0 };
+    for (uint_least32_t i = MAX_ORDER; i < n; i++)
+    {
+        const int_least32_t e0 = x[i];
+        const int_least32_t e1 = e0 - x[i-1];
+        const int_least32_t e2 = e1 - (x[i-1] - x[i-2]);
+        const int_least32_t e3 = e2 - (x[i-1] - 2 * x[i-2] + x[i-3]);
+        const int_least32_t e4 = e3 - (x[i-1] - 3 * x[i-2] + 3 * x[i-3] - x[i-4]);
+        sum[0] += std::abs(e0);
+        sum[1] += std::abs(e1);
+        sum[2] += std::abs(e2);
+        sum[3] += std::abs(e3);
+        sum[4] += std::abs(e4);
+    }
+
+    unsigned int order = 0;
+    for (unsigned int o = 1; o <= MAX_ORDER; o++)
+    {
+        if (sum[o] < sum[order])
+            order = o;
+    }
+
+    // Rough estimate of the Rice coded size
+    const uint_least32_t count = n - MAX_ORDER;
+    unsigned int param = 0;
+    while ((param < MAX_RICE_PARAM) && ((static_cast<uint_least64_t>(count) << (param + 1)) < sum[order]))
+        param++;
+    bits = static_cast<uint_least64_t>(count) * (param + 1) + (sum[order] >> param);
+    return order;
+}
+
+void residual(const int_least32_t* x, uint_least32_t n, unsigned int order, int_least32_t* res)
+{
+    switch (order)
+    {
+    case 0:
+        for (uint_least32_t i = 0; i < n; i++)
+            res[i] = x[i];
+        break;
+    case 1:
+        for (uint_least32_t i = 1; i < n; i++)
+            res[i] = x[i] - x[i-1];
+        break;
+    case 2:
+        for (uint_least32_t i = 2; i < n; i++)
+            res[i] = x[i] - 2 * x[i-1] + x[i-2];
+        break;
+    case 3:
+        for (uint_least32_t i = 3; i < n; i++)
+            res[i] = x[i] - 3 * x[i-1] + 3 * x[i-2] - x[i-3];
+        break;
+    case 4:
+        for (uint_least32_t i = 4; i < n; i++)
+            res[i] = x[i] - 4 * x[i-1] + 6 * x[i-2] - 4 * x[i-3] + x[i-4];
+        break;
+    }
+}
+
+// Best Rice parameter for a partition
+unsigned int riceParam(uint_least64_t sum, uint_least32_t count, uint_least64_t &bits)
+{
+    unsigned int best = 0;
+    bits = UINT64_MAX;
+    for (unsigned int k = 0; k <= MAX_RICE_PARAM; k++)
+    {
+        const uint_least64_t b = static_cast<uint_least64_t>(count) * (k + 1) + (sum >> k);
+        if (b < bits)
+        {
+            bits = b;
+            best = k;
+        }
+    }
+    return best;
+}
+
+/*
+ * Write a subframe, choosing between constant,
+ * fixed predictor and verbatim encoding.
+ */
+void writeSubframe(bitWriter &bw, const int_least32_t* x, uint_least32_t n, unsigned int bps, int_least32_t* res)
+{
+    if (std::all_of(x + 1, x + n, [x](int_least32_t v) { return v == x[0]; }))
+    {
+        bw.put(0x00, 8); // CONSTANT
+        bw.putSigned(x[0], bps);
+        return;
+    }
+
+    uint_least64_t estimate;
+    const unsigned int order = bestOrder(x, n, estimate);
+    const uint_least64_t verbatimBits = static_cast<uint_least64_t>(n) * bps;
+
+    if (estimate < verbatimBits)
+    {
+        residual(x, n, order, res);
+
+        // Partition sums at the highest possible order
+        unsigned int maxOrder = 0;
+        while ((maxOrder < MAX_PARTITION_ORDER)
+            && ((n % (2u << maxOrder)) == 0)
+            && ((n >> (maxOrder + 1)) > order))
+        {
+            maxOrder++;
+        }
+
+        uint_least64_t sums[1 << MAX_PARTITION_ORDER];
+        {
+            const uint_least32_t partSize = n >> maxOrder;
+            uint_least32_t i = order;
+            for (unsigned int p = 0; p < (1u << maxOrder); p++)
+            {
+                uint_least64_t sum = 0;
+                for (const uint_least32_t end = (p + 1) * partSize; i < end; i++)
+                    sum += zigzag(res[i]);
+                sums[p] = sum;
+            }
+        }
+
+        // Merge partitions going down to order zero
+        // keeping the cheapest one
+        unsigned int bestPartOrder = maxOrder;
+        uint_least64_t bestBits = UINT64_MAX;
+        unsigned int params[1 << MAX_PARTITION_ORDER];
+        for (int po = maxOrder; po >= 0; po--)
+        {
+            const unsigned int parts = 1u << po;
+            const uint_least32_t partSize = n >> po;
+            uint_least64_t bits = 0;
+            unsigned int tmpParams[1 << MAX_PARTITION_ORDER];
+            for (unsigned int p = 0; p < parts; p++)
+            {
+                const uint_least32_t count = (p == 0) ? partSize - order : partSize;
+                uint_least64_t b;
+                tmpParams[p] = riceParam(sums[p], count, b);
+                bits += b + 4;
+            }
+            if (bits < bestBits)
+            {
+                bestBits = bits;
+                bestPartOrder = po;
+                std::copy(tmpParams, tmpParams + parts, params);
+            }
+            for (unsigned int p = 0; p < parts / 2; p++)
+                sums[p] = sums[p * 2] + sums[p * 2 + 1];
+        }
+
+        if (bestBits + order * bps < verbatimBits)
+        {
+            bw.put(0x10 | (order << 1), 8); // FIXED
+            for (unsigned int i = 0; i < order; i++)
+                bw.putSigned(x[i], bps);
+
+            bw.put(0, 2); // Rice coding with 4 bits parameters
+            bw.put(bestPartOrder, 4);
+            const uint_least32_t partSize = n >> bestPartOrder;
+            uint_least32_t i = order;
+            for (unsigned int p = 0; p < (1u << bestPartOrder); p++)
+            {
+                const unsigned int param = params[p];
+                bw.put(param, 4);
+                for (const uint_least32_t end = (p + 1) * partSize; i < end; i++)
+                    bw.putRice(zigzag(res[i]), param);
+            }
+            return;
+        }
+    }
+
+    bw.put(0x02, 8); // VERBATIM
+    for (uint_least32_t i = 0; i < n; i++)
+        bw.putSigned(x[i], bps);
+}
+
+void putUtf8(bitWriter &bw, uint_least32_t value)
+{
+    if (value < 0x80)
+    {
+        bw.put(value, 8);
+        return;
+    }
+
+    const unsigned int bytes =
+        (value < 0x800) ? 2 :
+        (value < 0x10000) ? 3 :
+        (value < 0x200000) ? 4 :
+        (value < 0x4000000) ? 5 : 6;
+
+    bw.put(((0xff00 >> bytes) & 0xff) | (value >> (6 * (bytes - 1))), 8);
+    for (int i = bytes - 2; i >= 0; i--)
+        bw.put(0x80 | ((value >> (6 * i)) & 0x3f), 8);
+}
+
+void putLittle32(std::vector<uint8_t> &data, uint_least32_t value)
+{
+    data.push_back(static_cast<uint8_t>(value));
+    data.push_back(static_cast<uint8_t>(value >> 8));
+    data.push_back(static_cast<uint8_t>(value >> 16));
+    data.push_back(static_cast<uint8_t>(value >> 24));
+}
+
+void putComment(std::vector<uint8_t> &data, const char* field, const std::string &value)
+{
+    // Convert from Latin-1 to UTF-8
+    std::string comment(field);
+    for (unsigned char c: value)
+    {
+        if (c < 0x80)
+        {
+            comment.push_back(static_cast<char>(c));
+        }
+        else
+        {
+            comment.push_back(static_cast<char>(0xc0 | (c >> 6)));
+            comment.push_back(static_cast<char>(0x80 | (c & 0x3f)));
+        }
+    }
+
+    putLittle32(data, comment.size());
+    data.insert(data.end(), comment.begin(), comment.end());
+}
+
+}
+
+flacFile::flacFile(const std::string &name) :
+    AudioBase("FLACFILE"),
+    name(name),
+    hasInfo(false),
+    m_trackGain(0.),
+    m_trackPeak(0.),
+    hasReplayGain(false),
+    hasEnd(false),
+    file(nullptr),
+    m_channels(1),
+    m_frequency(0),
+    m_quit(false)
+{}
+
+void flacFile::encode(job &j, int channels, uint_least32_t frequency)
+{
+    const uint_least32_t n = j.frames;
+
+    int_least32_t* chan[2] = { &j.work[0], &j.work[BLOCK_SIZE] };
+    int_least32_t* mid = &j.work[BLOCK_SIZE * 2];
+    int_least32_t* side = &j.work[BLOCK_SIZE * 3];
+    int_least32_t* res = &j.work[BLOCK_SIZE * 4];
+
+    for (int c = 0; c < channels; c++)
+    {
+        for (uint_least32_t i = 0; i < n; i++)
+            chan[c][i] = j.samples[i * channels + c];
+    }
+
+    unsigned int assignment = channels - 1;
+    if (channels == 2)
+    {
+        for (uint_least32_t i = 0; i < n; i++)
+        {
+            mid[i] = (chan[0][i] + chan[1][i]) >> 1;
+            side[i] = chan[0][i] - chan[1][i];
+        }
+
+        // Pick the cheapest channel decorrelation
+        uint_least64_t left, right, m, s;
+        bestOrder(chan[0], n, left);
+        bestOrder(chan[1], n, right);
+        bestOrder(mid, n, m);
+        bestOrder(side, n, s);
+
+        assignment = CH_INDEPENDENT + 1;
+        uint_least64_t best = left + right;
+        if (left + s < best)
+        {
+            best = left + s;
+            assignment = CH_LEFT_SIDE;
+        }
+        if (right + s < best)
+        {
+            best = right + s;
+            assignment = CH_RIGHT_SIDE;
+        }
+        if (m + s < best)
+        {
+            assignment = CH_MID_SIDE;
+        }
+    }
+
+    bitWriter bw(j.data);
+
+    // Frame header
+    bw.put(0xfff8, 16); // sync code, fixed blocksize
+
+    unsigned int blockSizeCode;
+    if (n == BLOCK_SIZE)
+        blockSizeCode = 12;
+    else if (n <= 256)
+        blockSizeCode = 6;
+    else
+        blockSizeCode = 7;
+    bw.put(blockSizeCode, 4);
+
+    unsigned int rateCode;
+    switch (frequency)
+    {
+    case 88200:  rateCode = 1; break;
+    case 176400: rateCode = 2; break;
+    case 192000: rateCode = 3; break;
+    case 8000:   rateCode = 4; break;
+    case 16000:  rateCode = 5; break;
+    case 22050:  rateCode = 6; break;
+    case 24000:  rateCode = 7; break;
+    case 32000:  rateCode = 8; break;
+    case 44100:  rateCode = 9; break;
+    case 48000:  rateCode = 10; break;
+    case 96000:  rateCode = 11; break;
+    default:
+        if ((frequency % 1000) == 0 && (frequency <= 255000))
+            rateCode = 12;
+        else if (frequency <= 65535)
+            rateCode = 13;
+        else if ((frequency % 10) == 0 && (frequency <= 655350))
+            rateCode = 14;
+        else
+            rateCode = 0;
+        break;
+    }
+    bw.put(rateCode, 4);
+
+    bw.put(assignment, 4);
+    bw.put(4, 3); // 16 bits per sample
+    bw.put(0, 1);
+
+    putUtf8(bw, j.number);
+
+    if (blockSizeCode == 6)
+        bw.put(n - 1, 8);
+    else if (blockSizeCode == 7)
+        bw.put(n - 1, 16);
+
+    if (rateCode == 12)
+        bw.put(frequency / 1000, 8);
+    else if (rateCode == 13)
+        bw.put(frequency, 16);
+    else if (rateCode == 14)
+        bw.put(frequency / 10, 16);
+
+    bw.put(crc8(j.data.data(), bw.size()), 8);
+
+    // Subframes, the side channel needs an extra bit
+    switch (assignment)
+    {
+    case CH_LEFT_SIDE:
+        writeSubframe(bw, chan[0], n, 16, res);
+        writeSubframe(bw, side, n, 17, res);
+        break;
+    case CH_RIGHT_SIDE:
+        writeSubframe(bw, side, n, 17, res);
+        writeSubframe(bw, chan[1], n, 16, res);
+        break;
+    case CH_MID_SIDE:
+        writeSubframe(bw, mid, n, 16, res);
+        writeSubframe(bw, side, n, 17, res);
+        break;
+    default:
+        for (int c = 0; c < channels; c++)
+            writeSubframe(bw, chan[c], n, 16, res);
+        break;
+    }
+
+    // Frame footer
+    bw.align();
+    bw.put(crc16(j.data.data(), bw.size()), 16);
+}
+
+void flacFile::worker()
+{
+    for (;;)
+    {
+        unsigned int index;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_workCond.wait(lock, [this] { return m_quit || (m_queueLength != 0); });
+            if (m_queueLength == 0)
+                return;
+
+            index = m_queue[m_queueStart];
+            m_queueStart = (m_queueStart + 1) % m_queue.size();
+            m_queueLength--;
+        }
+
+        encode(m_jobs[index], m_channels, m_frequency);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_jobs[index].ready = true;
+        }
+        m_doneCond.notify_one();
+    }
+}
+
+void flacFile::submit()
+{
+    job &j = m_jobs[m_fill];
+    j.number = m_frameNumber++;
+    j.ready = false;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue[(m_queueStart + m_queueLength) % m_queue.size()] = m_fill;
+        m_queueLength++;
+    }
+    m_workCond.notify_one();
+
+    m_inFlight++;
+    m_fill = (m_fill + 1) % m_jobs.size();
+
+    // All the jobs are busy, wait for the oldest one
+    if (m_inFlight == m_jobs.size())
+        writeJob(true);
+
+    m_jobs[m_fill].frames = 0;
+}
+
+bool flacFile::writeJob(bool wait)
+{
+    job &j = m_jobs[m_head];
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!j.ready)
+        {
+            if (!wait)
+                return false;
+            m_doneCond.wait(lock, [&j] { return j.ready; });
+        }
+    }
+
+    // Frames past the end of the song are dropped
+    if (!hasEnd || (j.number < m_endFrame))
+    {
+        m_frameOffsets[j.number % FRAME_HISTORY] = m_written;
+        file->write(reinterpret_cast<const char*>(j.data.data()), j.data.size());
+
+        const uint_least32_t size = j.data.size();
+        if ((m_minFrameSize == 0) || (size < m_minFrameSize))
+            m_minFrameSize = size;
+        if (size > m_maxFrameSize)
+            m_maxFrameSize = size;
+        m_written += size;
+        m_framesWritten++;
+    }
+
+    m_head = (m_head + 1) % m_jobs.size();
+    m_inFlight--;
+    return true;
+}
+
+void flacFile::writeStreamInfo(const uint8_t* digest)
+{
+    std::vector<uint8_t> data;
+    bitWriter bw(data);
+    bw.put(0, 1);  // not the last block
+    bw.put(0, 7);  // STREAMINFO
+    bw.put(34, 24);
+    bw.put(BLOCK_SIZE, 16);
+    bw.put(BLOCK_SIZE, 16);
+    bw.put(m_minFrameSize, 24);
+    bw.put(m_maxFrameSize, 24);
+    bw.put(m_frequency, 20);
+    bw.put(m_channels - 1, 3);
+    bw.put(15, 5); // 16 bits per sample
+    bw.put(static_cast<uint_least32_t>(m_totalFrames >> 32), 4);
+    bw.put(static_cast<uint_least32_t>(m_totalFrames), 32);
+    for (int i = 0; i < 16; i++)
+        bw.put(digest[i], 8);
+
+    file->write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+void flacFile::writeHeader()
+{
+    file->write("fLaC", 4);
+
+    // Placeholder, the actual values are written at close
+    const uint8_t digest[16] = { 0 };
+    writeStreamInfo(digest);
+    writeComments();
+}
+
+/*
+ * The comments are followed by a padding block which shrinks
+ * as the ReplayGain values are added, so the size of the header
+ * doesn't change when it's rewritten at close.
+ */
+void flacFile::writeComments()
+{
+    std::vector<uint8_t> comments;
+    putLittle32(comments, sizeof(VENDOR) - 1);
+    comments.insert(comments.end(), VENDOR, VENDOR + sizeof(VENDOR) - 1);
+    putLittle32(comments, (hasInfo ? 3 : 0) + (hasReplayGain ? 2 : 0));
+    if (hasInfo)
+    {
+        putComment(comments, "TITLE=", m_title);
+        putComment(comments, "ARTIST=", m_author);
+        putComment(comments, "COPYRIGHT=", m_released);
+    }
+
+    const std::size_t base = comments.size();
+    if (hasReplayGain)
+    {
+        char value[32];
+        std::snprintf(value, sizeof(value), "%+.2f dB", m_trackGain);
+        putComment(comments, "REPLAYGAIN_TRACK_GAIN=", value);
+        std::snprintf(value, sizeof(value), "%.6f", m_trackPeak);
+        putComment(comments, "REPLAYGAIN_TRACK_PEAK=", value);
+    }
+    const uint_least32_t padding = REPLAYGAIN_SPACE - (comments.size() - base);
+
+    const uint_least32_t length = comments.size();
+    const char header[4] =
+    {
+        static_cast<char>(0x04), // VORBIS_COMMENT
+        static_cast<char>(length >> 16),
+        static_cast<char>(length >> 8),
+        static_cast<char>(length)
+    };
+    file->write(header, 4);
+    file->write(reinterpret_cast<const char*>(comments.data()), comments.size());
+
+    const char paddingHeader[4] =
+    {
+        static_cast<char>(0x81), // last block, PADDING
+        static_cast<char>(padding >> 16),
+        static_cast<char>(padding >> 8),
+        static_cast<char>(padding)
+    };
+    file->write(paddingHeader, 4);
+    const std::vector<char> zeros(padding, 0);
+    file->write(zeros.data(), zeros.size());
+}
+
+bool flacFile::open(AudioConfig &cfg)
+{
+    // FLAC stores integer samples only
+    cfg.precision = 16;
+    cfg.bufSize = cfg.frequency;
+
+    if (name.empty())
+        return false;
+
+    if (file)
+        close();
+
+    m_channels = cfg.channels;
+    m_frequency = cfg.frequency;
+
+    // Keep a couple of frames per worker in flight
+    unsigned int workers = std::thread::hardware_concurrency();
+    workers = std::min(std::max(workers, 1u), MAX_WORKERS);
+
+    if (name.compare("-") == 0)
+    {
+        file = &std::cout;
+    }
+    else
+    {
+        file = new std::ofstream(name.c_str(), std::ios::out|std::ios::binary|std::ios::trunc);
+        if (file->fail())
+        {
+            setError("Unable to open output file.");
+            delete file;
+            file = nullptr;
+            return false;
+        }
+    }
+
+    // Drop the output and the buffers, the file is left empty
+    auto fail = [this](const char *msg)
+    {
+        setError(msg);
+        if (file != &std::cout)
+            delete file;
+        file = nullptr;
+        delete[] m_sampleBuffer;
+        m_sampleBuffer = nullptr;
+        return false;
+    };
+
+    // We need to make a buffer for the user
+    try
+    {
+        m_sampleBuffer = new short[cfg.bufSize * m_channels];
+
+        m_jobs.resize(workers * 2);
+        for (job &j: m_jobs)
+        {
+            j.samples.resize(BLOCK_SIZE * m_channels);
+            j.work.resize(BLOCK_SIZE * 5);
+            j.data.reserve(BLOCK_SIZE * m_channels * 3 + 32);
+        }
+        m_queue.resize(m_jobs.size());
+        m_frameOffsets.resize(FRAME_HISTORY);
+    }
+    catch (std::bad_alloc const &ba)
+    {
+        return fail("Unable to allocate memory for sample buffers.");
+    }
+
+    hasReplayGain = false;
+    hasEnd = false;
+    m_md5.reset();
+    m_totalFrames = 0;
+    m_minFrameSize = 0;
+    m_maxFrameSize = 0;
+    m_frameNumber = 0;
+    m_framesWritten = 0;
+    m_written = 0;
+    m_head = 0;
+    m_fill = 0;
+    m_inFlight = 0;
+    m_queueStart = 0;
+    m_queueLength = 0;
+    m_jobs[0].frames = 0;
+    m_quit = false;
+
+    writeHeader();
+    m_headerSize = (file != &std::cout) ? static_cast<uint_least64_t>(file->tellp()) : 0;
+
+    try
+    {
+        for (unsigned int i = 0; i < workers; i++)
+            m_workers.emplace_back(&flacFile::worker, this);
+    }
+    catch (std::system_error const &e)
+    {
+        if (m_workers.empty())
+            return fail("Unable to start encoder threads.");
+    }
+
+    m_settings = cfg;
+    return true;
+}
+
+bool flacFile::write(uint_least32_t frames)
+{
+    if (file && !file->fail())
+    {
+        const short* in = m_sampleBuffer;
+
+#if defined(WORDS_BIGENDIAN)
+        for (uint_least32_t i = 0; i < frames * m_channels; i++)
+        {
+            const uint8_t sample[2] = { static_cast<uint8_t>(in[i]), static_cast<uint8_t>(in[i] >> 8) };
+            m_md5.update(sample, 2);
+        }
+#else
+        m_md5.update(reinterpret_cast<const uint8_t*>(in), frames * m_channels * sizeof(short));
+#endif
+        m_totalFrames += frames;
+
+        while (frames)
+        {
+            job &j = m_jobs[m_fill];
+            const uint_least32_t n = std::min(frames, BLOCK_SIZE - j.frames);
+            std::copy(in, in + n * m_channels, j.samples.begin() + j.frames * m_channels);
+            j.frames += n;
+            in += n * m_channels;
+            frames -= n;
+
+            if (j.frames == BLOCK_SIZE)
+                submit();
+        }
+
+        // Write out the frames already encoded
+        while (m_inFlight && writeJob(false)) {}
+    }
+    return true;
+}
+
+void flacFile::close()
+{
+    if (file && !file->fail())
+    {
+        if (m_jobs[m_fill].frames)
+            submit();
+        while (m_inFlight)
+            writeJob(true);
+    }
+
+    if (!m_workers.empty())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_quit = true;
+        }
+        m_workCond.notify_all();
+        for (std::thread &t: m_workers)
+            t.join();
+        m_workers.clear();
+    }
+
+    if (file && !file->fail())
+    {
+        if (file != &std::cout)
+        {
+            // update the stream info
+            uint8_t digest[16];
+            m_md5.finish(digest);
+
+            // cut at the frame boundary following the end of the song,
+            // the signature covers the dropped samples so it's cleared
+            const bool cut = hasEnd && (m_endFrame * BLOCK_SIZE < m_totalFrames);
+            if (cut)
+            {
+                m_totalFrames = m_endFrame * BLOCK_SIZE;
+                std::fill(digest, digest + 16, 0);
+            }
+
+            file->seekp(4, std::ios::beg);
+            writeStreamInfo(digest);
+            // the comments follow
+            if (hasReplayGain)
+                writeComments();
+            delete file;
+
+            // drop the frames written before the end was known
+            if (cut && (m_endFrame < m_framesWritten))
+                truncateFile(name, m_headerSize + m_frameOffsets[m_endFrame % FRAME_HISTORY]);
+        }
+        file = nullptr;
+    }
+    else if (file && (file != &std::cout))
+    {
+        delete file;
+        file = nullptr;
+    }
+
+    delete[] m_sampleBuffer;
+    m_sampleBuffer = nullptr;
+}
+
+void flacFile::setInfo(const char* title, const char* author, const char* released)
+{
+    hasInfo = true;
+    m_title = title;
+    m_author = author;
+    m_released = released;
+}
+
+bool flacFile::setEnd(uint_least64_t frames)
+{
+    if (!file || (file == &std::cout))
+        return false;
+
+    // The start of the first dropped frame must be still known
+    const uint_least64_t frame = (frames + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    if (frame + FRAME_HISTORY < m_framesWritten)
+        return false;
+
+    hasEnd = true;
+    m_endFrame = frame;
+    return true;
+}
+
+void flacFile::setReplayGain(double gain, double peak)
+{
+    // Both values must fit in the reserved space
+    if ((std::fabs(gain) >= 1000.) || (peak < 0.) || (peak >= 1000.))
+        return;
+
+    hasReplayGain = true;
+    m_trackGain = gain;
+    m_trackPeak = peak;
+}
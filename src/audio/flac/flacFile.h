@@ -0,0 +1,140 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef FLAC_FILE_H
+#define FLAC_FILE_H
+
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../AudioBase.h"
+#include "md5.h"
+
+/*
+ * A basic FLAC output file type
+ *
+ * Uses fixed blocksize frames with fixed linear predictors
+ * and Rice coded residuals. Frames are encoded in parallel
+ * by a pool of worker threads and written in order.
+ */
+class flacFile final : public AudioBase
+{
+private:
+    struct job
+    {
+        std::vector<short> samples;         // interleaved input samples
+        std::vector<int_least32_t> work;    // encoder scratch buffers
+        std::vector<uint8_t> data;          // encoded frame
+        uint_least32_t frames;
+        uint_least32_t number;
+        bool ready;
+    };
+
+private:
+    std::string name;
+
+    std::string m_title;
+    std::string m_author;
+    std::string m_released;
+    bool hasInfo;
+
+    double m_trackGain;
+    double m_trackPeak;
+    bool hasReplayGain;
+
+    bool hasEnd;
+    uint_least64_t m_endFrame;
+
+    std::ostream *file;
+    int m_channels;
+    uint_least32_t m_frequency;
+
+    md5 m_md5;
+    uint_least64_t m_totalFrames;
+    uint_least32_t m_minFrameSize;
+    uint_least32_t m_maxFrameSize;
+    uint_least32_t m_frameNumber;
+
+    // Frames written to the file and their start offsets
+    uint_least64_t m_headerSize;
+    uint_least64_t m_written;
+    uint_least64_t m_framesWritten;
+    std::vector<uint_least64_t> m_frameOffsets;
+
+    // Ring of jobs, from m_head to m_fill are in flight
+    std::vector<job> m_jobs;
+    unsigned int m_head;
+    unsigned int m_fill;
+    unsigned int m_inFlight;
+
+    // Jobs waiting for a worker
+    std::vector<unsigned int> m_queue;
+    unsigned int m_queueStart;
+    unsigned int m_queueLength;
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_workCond;
+    std::condition_variable m_doneCond;
+    bool m_quit;
+
+private:
+    void writeHeader();
+    void writeStreamInfo(const uint8_t* digest);
+    void writeComments();
+    void submit();
+    bool writeJob(bool wait);
+    void worker();
+
+    static void encode(job &j, int channels, uint_least32_t frequency);
+
+public:
+    explicit flacFile(const std::string &name);
+    ~flacFile() override { close(); }
+
+    static const char *extension () { return ".flac"; }
+
+    // Only signed 16-bit samples are supported.
+
+    bool open(AudioConfig &cfg) override;
+
+    // After write call old buffer is invalid and you should
+    // use the new buffer provided instead.
+    bool write(uint_least32_t frames) override;
+    void close() override;
+    void pause() override {}
+    void reset() override {}
+
+    void setInfo(const char* title, const char* author, const char* released);
+
+    // Add ReplayGain comments, written at close
+    // in the space reserved in the header.
+    void setReplayGain(double gain, double peak) override;
+
+    // Drop the frames past the end of the song,
+    // the output is cut at a frame boundary.
+    bool setEnd(uint_least64_t frames) override;
+};
+
+#endif /* FLAC_FILE_H */
@@ -0,0 +1,167 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "md5.h"
+
+#include <cstring>
+
+namespace
+{
+
+const uint32_t K[64] =
+{
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+const unsigned int R[64] =
+{
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+};
+
+inline uint32_t rotate(uint32_t x, unsigned int c)
+{
+    return (x << c) | (x >> (32 - c));
+}
+
+}
+
+void md5::reset()
+{
+    m_state[0] = 0x67452301;
+    m_state[1] = 0xefcdab89;
+    m_state[2] = 0x98badcfe;
+    m_state[3] = 0x10325476;
+    m_length = 0;
+}
+
+void md5::transform(const uint8_t* block)
+{
+    uint32_t w[16];
+    for (unsigned int i = 0; i < 16; i++)
+    {
+        w[i] = static_cast<uint32_t>(block[i*4])
+            | (static_cast<uint32_t>(block[i*4+1]) << 8)
+            | (static_cast<uint32_t>(block[i*4+2]) << 16)
+            | (static_cast<uint32_t>(block[i*4+3]) << 24);
+    }
+
+    uint32_t a = m_state[0];
+    uint32_t b = m_state[1];
+    uint32_t c = m_state[2];
+    uint32_t d = m_state[3];
+
+    for (unsigned int i = 0; i < 64; i++)
+    {
+        uint32_t f;
+        unsigned int g;
+        if (i < 16)
+        {
+            f = (b & c) | (~b & d);
+            g = i;
+        }
+        else if (i < 32)
+        {
+            f = (d & b) | (~d & c);
+            g = (5 * i + 1) & 15;
+        }
+        else if (i < 48)
+        {
+            f = b ^ c ^ d;
+            g = (3 * i + 5) & 15;
+        }
+        else
+        {
+            f = c ^ (b | ~d);
+            g = (7 * i) & 15;
+        }
+
+        const uint32_t tmp = d;
+        d = c;
+        c = b;
+        b = b + rotate(a + f + K[i] + w[g], R[i]);
+        a = tmp;
+    }
+
+    m_state[0] += a;
+    m_state[1] += b;
+    m_state[2] += c;
+    m_state[3] += d;
+}
+
+void md5::update(const uint8_t* data, std::size_t length)
+{
+    std::size_t used = m_length & 63;
+    m_length += length;
+
+    if (used)
+    {
+        const std::size_t fill = 64 - used;
+        if (length < fill)
+        {
+            std::memcpy(m_buffer + used, data, length);
+            return;
+        }
+        std::memcpy(m_buffer + used, data, fill);
+        transform(m_buffer);
+        data += fill;
+        length -= fill;
+    }
+
+    while (length >= 64)
+    {
+        transform(data);
+        data += 64;
+        length -= 64;
+    }
+
+    std::memcpy(m_buffer, data, length);
+}
+
+void md5::finish(uint8_t digest[16])
+{
+    const uint64_t bits = m_length * 8;
+
+    uint8_t padding[72] = { 0x80 };
+    const std::size_t used = m_length & 63;
+    const std::size_t padLength = (used < 56) ? (56 - used) : (120 - used);
+    for (unsigned int i = 0; i < 8; i++)
+    {
+        padding[padLength + i] = static_cast<uint8_t>(bits >> (i * 8));
+    }
+    update(padding, padLength + 8);
+
+    for (unsigned int i = 0; i < 4; i++)
+    {
+        digest[i*4]   = static_cast<uint8_t>(m_state[i]);
+        digest[i*4+1] = static_cast<uint8_t>(m_state[i] >> 8);
+        digest[i*4+2] = static_cast<uint8_t>(m_state[i] >> 16);
+        digest[i*4+3] = static_cast<uint8_t>(m_state[i] >> 24);
+    }
+}
@@ -0,0 +1,54 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef MD5_H
+#define MD5_H
+
+#include <stdint.h>
+#include <cstddef>
+
+/*
+ * MD5 message digest (RFC 1321)
+ */
+class md5
+{
+private:
+    uint32_t m_state[4];
+    uint64_t m_length;
+    uint8_t m_buffer[64];
+
+private:
+    void transform(const uint8_t* block);
+
+public:
+    md5() { reset(); }
+
+    void reset();
+
+    void update(const uint8_t* data, std::size_t length);
+
+    /**
+     * Complete the computation, the object
+     * must be reset before being used again.
+     */
+    void finish(uint8_t digest[16]);
+};
+
+#endif // MD5_H
@@ -46,6 +46,7 @@ public:  // --------------------------------------------------------- public
     void reset () override {}
     bool write (uint_least32_t frames) override;
     void pause () override {}
+    bool discard() const override { return true; }
     void clearBuffer() override {}
 };
 
@@ -0,0 +1,334 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "rawFile.h"
+
+#include "../asyncWriter.h"
+
+#include <new>
+#include <utility>
+
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#  include <io.h>
+#else
+#  include <unistd.h>
+#  include <sys/mman.h>
+#endif
+
+#ifdef HAVE_VMSPLICE
+#  include <sys/uio.h>
+#endif
+
+#ifndef O_BINARY
+#  define O_BINARY 0
+#endif
+
+namespace
+{
+
+std::size_t getPageSize()
+{
+#ifdef _WIN32
+    return 4096;
+#else
+    const long size = sysconf(_SC_PAGESIZE);
+    return (size > 0) ? size : 4096;
+#endif
+}
+
+#if defined(WORDS_BIGENDIAN)
+inline void swap16(char* p)
+{
+    std::swap(p[0], p[1]);
+}
+
+inline void swap32(char* p)
+{
+    std::swap(p[0], p[3]);
+    std::swap(p[1], p[2]);
+}
+#endif
+
+}
+
+rawFile::rawFile(const std::string &name, unsigned int queueDepth) :
+    AudioBase("RAWFILE"),
+    name(name),
+    m_fd(-1),
+    m_splice(false),
+    m_precision(16),
+    m_channels(1),
+    m_queueDepth(queueDepth ? queueDepth : 1),
+    m_memory(nullptr),
+    m_memorySize(0),
+    m_current(0),
+    m_bytes(0),
+    hasEnd(false),
+    endFrame(0)
+{}
+
+bool rawFile::allocate(std::size_t bufBytes, unsigned int count)
+{
+#ifdef _WIN32
+    const std::size_t pageSize = getPageSize();
+
+    // over allocate to align the first buffer
+    m_memorySize = bufBytes * count + pageSize;
+    try
+    {
+        m_memory = new char[m_memorySize];
+    }
+    catch (std::bad_alloc const &ba)
+    {
+        return false;
+    }
+    const std::uintptr_t addr = reinterpret_cast<std::uintptr_t>(m_memory);
+    char* base = m_memory + ((pageSize - (addr % pageSize)) % pageSize);
+#else
+    // Pages still queued in a pipe stay referenced by the kernel
+    // after unmapping, so the memory can be released at any time
+    m_memorySize = bufBytes * count;
+    void* mem = mmap(nullptr, m_memorySize, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+        return false;
+    m_memory = static_cast<char*>(mem);
+    char* base = m_memory;
+#endif
+
+    m_buffers.resize(count);
+    for (unsigned int i = 0; i < count; i++)
+        m_buffers[i] = base + i * bufBytes;
+    return true;
+}
+
+void rawFile::release()
+{
+    if (m_memory)
+    {
+#ifdef _WIN32
+        delete[] m_memory;
+#else
+        munmap(m_memory, m_memorySize);
+#endif
+        m_memory = nullptr;
+    }
+    m_buffers.clear();
+    m_sampleBuffer = nullptr;
+}
+
+bool rawFile::open(AudioConfig &cfg)
+{
+    m_precision = cfg.precision;
+    m_channels = cfg.channels;
+
+    if (name.empty())
+        return false;
+
+    if (m_fd >= 0)
+        close();
+
+    // Round the buffer up to whole pages
+    const std::size_t pageSize = getPageSize();
+    const std::size_t frameBytes = (m_precision / 8) * m_channels;
+    if (cfg.bufSize == 0)
+        cfg.bufSize = cfg.frequency / 4;
+    const std::size_t bufBytes = ((cfg.bufSize * frameBytes + pageSize - 1) / pageSize) * pageSize;
+    cfg.bufSize = bufBytes / frameBytes;
+
+    if (name.compare("-") == 0)
+    {
+        m_fd = 1;
+#ifdef _WIN32
+        _setmode(m_fd, _O_BINARY);
+#endif
+    }
+    else
+    {
+        m_fd = ::open(name.c_str(), O_WRONLY|O_CREAT|O_TRUNC|O_BINARY, 0666);
+        if (m_fd < 0)
+        {
+            setError("Unable to open output file.");
+            return false;
+        }
+    }
+
+    // A single buffer is enough when writes complete synchronously
+    unsigned int count = 1;
+    m_splice = false;
+
+#if defined(HAVE_VMSPLICE) && defined(F_SETPIPE_SZ)
+    struct stat st;
+    if ((fstat(m_fd, &st) == 0) && S_ISFIFO(st.st_mode))
+    {
+        // Don't let the consumer fall behind more than the queue depth.
+        // May fail if above the system limit, keep the current size then.
+        fcntl(m_fd, F_SETPIPE_SZ, static_cast<int>(bufBytes * m_queueDepth));
+        const int pipeSize = fcntl(m_fd, F_GETPIPE_SZ);
+        if (pipeSize > 0)
+        {
+            // A buffer can be reused only after the pipe has been
+            // filled by the following ones, so the consumer must
+            // have already read it
+            m_splice = true;
+            count = (pipeSize + bufBytes - 1) / bufBytes + 2;
+        }
+    }
+#endif
+
+    if (!allocate(bufBytes, count))
+    {
+        setError("Unable to allocate memory for sample buffers.");
+        close();
+        return false;
+    }
+
+    m_current = 0;
+    m_sampleBuffer = reinterpret_cast<short*>(m_buffers[0]);
+    m_bytes = 0;
+    hasEnd = false;
+
+    m_settings = cfg;
+    return true;
+}
+
+bool rawFile::output(const char* data, std::size_t bytes)
+{
+#ifdef HAVE_VMSPLICE
+    if (m_splice)
+    {
+        struct iovec iov;
+        iov.iov_base = const_cast<char*>(data);
+        iov.iov_len = bytes;
+        while (iov.iov_len)
+        {
+            const ssize_t n = vmsplice(m_fd, &iov, 1, 0);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            iov.iov_base = static_cast<char*>(iov.iov_base) + n;
+            iov.iov_len -= n;
+        }
+        return true;
+    }
+#endif
+
+    while (bytes)
+    {
+#ifdef _WIN32
+        const int n = _write(m_fd, data, static_cast<unsigned int>(bytes));
+#else
+        const ssize_t n = ::write(m_fd, data, bytes);
+#endif
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += n;
+        bytes -= n;
+    }
+    return true;
+}
+
+bool rawFile::write(uint_least32_t frames)
+{
+    if (m_fd < 0)
+        return true;
+
+    const uint_least32_t size = frames * m_channels;
+    char* buffer = m_buffers[m_current];
+    std::size_t bytes;
+
+    if (m_precision == 16)
+    {
+#if defined(WORDS_BIGENDIAN)
+        for (uint_least32_t i = 0; i < size; i++)
+            swap16(buffer + i * 2);
+#endif
+        bytes = size * 2;
+    }
+    else
+    {
+        // Convert in place starting from the end,
+        // each float only overwrites samples already converted
+        const short* in = m_sampleBuffer;
+        for (uint_least32_t i = size; i-- > 0; )
+        {
+            const float sample = static_cast<float>(in[i]) / 32768.f;
+            char* out = buffer + i * 4;
+            std::memcpy(out, &sample, 4);
+#if defined(WORDS_BIGENDIAN)
+            swap32(out);
+#endif
+        }
+        bytes = size * 4;
+    }
+
+    if (!output(buffer, bytes))
+    {
+        setError("Unable to write output.");
+        return false;
+    }
+    m_bytes += bytes;
+
+    m_current = (m_current + 1) % m_buffers.size();
+    m_sampleBuffer = reinterpret_cast<short*>(m_buffers[m_current]);
+    return true;
+}
+
+void rawFile::close()
+{
+    if (m_fd >= 0)
+    {
+        if (m_fd != 1)
+        {
+            ::close(m_fd);
+
+            // cut the data at the end of the song
+            const uint_least64_t endBytes = endFrame * (m_precision / 8) * m_channels;
+            if (hasEnd && (endBytes < m_bytes))
+                truncateFile(name, endBytes);
+        }
+        m_fd = -1;
+    }
+    release();
+}
+
+bool rawFile::setEnd(uint_least64_t frames)
+{
+    // Data sent to a pipe can't be taken back
+    if ((m_fd < 0) || (m_fd == 1) || m_splice)
+        return false;
+
+    hasEnd = true;
+    endFrame = frames;
+    return true;
+}
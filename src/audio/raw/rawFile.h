@@ -0,0 +1,92 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef RAW_FILE_H
+#define RAW_FILE_H
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <string>
+#include <vector>
+
+#include <cstddef>
+
+#include "../AudioBase.h"
+
+/*
+ * Headerless PCM output, signed 16-bit or 32-bit float
+ * little endian samples.
+ *
+ * The sample buffer handed to the player rotates over a ring
+ * of page aligned buffers so that, when writing to a pipe,
+ * data can be spliced without copying. The pipe is sized to
+ * hold at most the configured queue depth.
+ */
+class rawFile final : public AudioBase
+{
+private:
+    std::string name;
+
+    int m_fd;
+    bool m_splice;
+    int m_precision;
+    int m_channels;
+    unsigned int m_queueDepth;
+
+    char *m_memory;
+    std::size_t m_memorySize;
+    std::vector<char*> m_buffers;
+    unsigned int m_current;
+
+    uint_least64_t m_bytes;
+    bool hasEnd;
+    uint_least64_t endFrame;
+
+private:
+    bool output(const char* data, std::size_t bytes);
+    bool allocate(std::size_t bufBytes, unsigned int count);
+    void release();
+
+public:
+    rawFile(const std::string &name, unsigned int queueDepth);
+    ~rawFile() override { close(); }
+
+    static const char *extension () { return ".raw"; }
+
+    // Only signed 16-bit and 32bit float samples are supported.
+    // Endian-ess is adjusted if necessary.
+
+    bool open(AudioConfig &cfg) override;
+
+    // After write call old buffer is invalid and you should
+    // use the new buffer provided instead.
+    bool write(uint_least32_t frames) override;
+    void close() override;
+    void pause() override {}
+    void reset() override {}
+
+    // Drop the data past the end of the song,
+    // only regular files can be cut.
+    bool setEnd(uint_least64_t frames) override;
+};
+
+#endif /* RAW_FILE_H */
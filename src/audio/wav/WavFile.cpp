@@ -27,7 +27,9 @@
 #include <iomanip>
 #include <fstream>
 #include <new>
+#include <system_error>
 
+#include <cstdio>
 #include <cstring>
 
 // Get the lo byte (8 bit) in a dword (32 bit)
@@ -78,6 +80,25 @@ inline void endian_little32 (uint8_t ptr[4], uint_least32_t dword)
     ptr[3] = endian_16hi8  (word);
 }
 
+/* XXX endianness... */
+static std::size_t convert16(char *, std::size_t samples)
+{
+    return samples * 2;
+}
+
+// normalize floats, in place starting from the end
+// so that only already converted samples are overwritten
+static std::size_t convertFloat(char *buffer, std::size_t samples)
+{
+    const short *in = (const short*)buffer;
+    for (std::size_t i=samples; i-- > 0; )
+    {
+        const float sample = ((float)in[i])/32768.f;
+        std::memcpy(buffer + i*4, &sample, 4);
+    }
+    return samples * 4;
+}
+
 const riffHeader WavFile::defaultRiffHdr =
 {
     // ASCII keywords are hexified.
@@ -117,15 +138,43 @@ const listInfo WavFile::defaultListInfo =
     {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0}
 };
 
-WavFile::WavFile(const std::string &name) :
+const sampleInfo WavFile::defaultSampleInfo =
+{
+    {0x73,0x6D,0x70,0x6C}, // 'smpl'
+    {60,0,0,0},            // length
+    {0,0,0,0},             // manufacturer
+    {0,0,0,0},             // product
+    {0,0,0,0},             // sample period
+    {60,0,0,0},            // unity note (middle C)
+    {0,0,0,0},             // pitch fraction
+    {0,0,0,0},             // SMPTE format
+    {0,0,0,0},             // SMPTE offset
+    {1,0,0,0},             // loops
+    {0,0,0,0},             // sampler data
+    {0,0,0,0},             // cue point ID
+    {0,0,0,0},             // type (forward)
+    {0,0,0,0},             // start
+    {0,0,0,0},             // end
+    {0,0,0,0},             // fraction
+    {0,0,0,0}              // play count (forever)
+};
+
+WavFile::WavFile(const std::string &name, unsigned int queueDepth) :
     AudioBase("WAVFILE"),
     name(name),
     riffHdr(defaultRiffHdr),
     wavHdr(defaultWavHdr),
     listHdr(defaultListInfo),
+    sampleHdr(defaultSampleInfo),
     file(nullptr),
+    m_writer(nullptr),
+    m_queueDepth(queueDepth ? queueDepth : 1),
+    m_preallocated(false),
     headerWritten(false),
     hasListInfo(false),
+    hasLoop(false),
+    hasEnd(false),
+    hasReplayGain(false),
     m_precision(32)
 {}
 
@@ -145,21 +194,15 @@ bool WavFile::open(AudioConfig &cfg)
     if (name.empty())
         return false;
 
-    if (file && !file->fail())
+    if (file)
         close();
 
     dataSize = 0;
-
-    // We need to make a buffer for the user
-    try
-    {
-        m_sampleBuffer = new short[bufSize/2];
-    }
-    catch (std::bad_alloc const &ba)
-    {
-        setError("Unable to allocate memory for sample buffers.");
-        return false;
-    }
+    headerWritten = false;
+    m_preallocated = false;
+    hasLoop = false;
+    hasEnd = false;
+    hasReplayGain = false;
 
     // Fill in header with parameters and expected file size.
     endian_little32(riffHdr.length, sizeof(riffHeader)+sizeof(wavHeader)-8);
@@ -178,15 +221,46 @@ bool WavFile::open(AudioConfig &cfg)
     else
     {
         file = new std::ofstream(name.c_str(), std::ios::out|std::ios::binary|std::ios::trunc);
+        if (file->fail())
+        {
+            setError("Unable to open output file.");
+            delete file;
+            file = nullptr;
+            return false;
+        }
     }
 
+    auto fail = [this](const char *msg)
+    {
+        setError(msg);
+        if (file != &std::cout)
+            delete file;
+        file = nullptr;
+        return false;
+    };
+
+    // The writer buffers are handed to the user
+    try
+    {
+        m_writer = new asyncWriter(*file, (m_precision == 16) ? convert16 : convertFloat, m_queueDepth, bufSize);
+    }
+    catch (std::bad_alloc const &ba)
+    {
+        return fail("Unable to allocate memory for sample buffers.");
+    }
+    catch (std::system_error const &e)
+    {
+        return fail("Unable to start writer thread.");
+    }
+    m_sampleBuffer = reinterpret_cast<short*>(m_writer->buffer());
+
     m_settings = cfg;
     return true;
 }
 
 bool WavFile::write(uint_least32_t frames)
 {
-    if (file && !file->fail())
+    if (m_writer && !m_writer->failed())
     {
         uint_least32_t size = frames * m_channels;
         unsigned long int bytes = size;
@@ -199,23 +273,10 @@ bool WavFile::write(uint_least32_t frames)
             headerWritten = true;
         }
 
-        /* XXX endianness... */
-        if (m_precision == 16)
-        {
-            bytes *= 2;
-            file->write((char*)m_sampleBuffer, bytes);
-        }
-        else
-        {
-            std::vector<float> buffer(size);
-            bytes *= 4;
-            // normalize floats
-            for (unsigned long i=0; i<size; i++)
-            {
-                buffer[i] = ((float)m_sampleBuffer[i])/32768.f;
-            }
-            file->write((char*)&buffer.front(), bytes);
-        }
+        // Conversion is done by the writer thread
+        bytes *= (m_precision == 16) ? 2 : 4;
+        m_writer->submit(size);
+        m_sampleBuffer = reinterpret_cast<short*>(m_writer->buffer());
         dataSize += bytes;
     }
     return true;
@@ -223,26 +284,137 @@ bool WavFile::write(uint_least32_t frames)
 
 void WavFile::close()
 {
+    if (m_writer)
+    {
+        m_writer->flush();
+        delete m_writer;
+        m_writer = nullptr;
+        m_sampleBuffer = nullptr;
+    }
+
     if (file && !file->fail())
     {
         // update length fields in header
         unsigned long int headerSize = sizeof(riffHeader)+sizeof(wavHeader)-8;
         if (hasListInfo)
             headerSize += sizeof(listInfo);
-        endian_little32(riffHdr.length, headerSize+dataSize);
+
+        // cut the data at the end of the loop or of the song
+        const unsigned long int blockAlign = m_channels * (m_precision / 8);
+        const bool loop = hasLoop && (file != &std::cout) && (loopEnd * blockAlign <= dataSize);
+        const bool cut = hasEnd && (file != &std::cout) && (endFrame * blockAlign < dataSize);
+        if (loop)
+            dataSize = loopEnd * blockAlign;
+        else if (cut)
+            dataSize = endFrame * blockAlign;
+
+        // chunks following the data
+        std::vector<char> trailer;
+        if (file != &std::cout)
+        {
+            if (loop)
+                trailer.insert(trailer.end(), (char*)&sampleHdr, (char*)&sampleHdr + sizeof(sampleInfo));
+            if (hasReplayGain)
+                addReplayGain(trailer);
+        }
+        const unsigned long int trailerSize = trailer.size();
+
+        endian_little32(riffHdr.length, headerSize+dataSize+trailerSize);
         endian_little32(wavHdr.dataChunkLen, dataSize);
         if (file != &std::cout)
         {
+            if (!trailer.empty())
+            {
+                file->seekp(headerSize+8+dataSize, std::ios::beg);
+                file->write(trailer.data(), trailer.size());
+            }
             file->seekp(0, std::ios::beg);
             file->write((char*)&riffHdr, sizeof(riffHeader));
             if (hasListInfo)
                 file->write((char*)&listHdr, sizeof(listInfo));
             file->write((char*)&wavHdr, sizeof(wavHeader));
             delete file;
+
+            // release the space reserved past the end
+            if (m_preallocated || loop || cut)
+                truncateFile(name, headerSize+dataSize+trailerSize+8);
         }
         file = nullptr;
-        delete[] m_sampleBuffer;
     }
+    else if (file && (file != &std::cout))
+    {
+        delete file;
+        file = nullptr;
+    }
+}
+
+void WavFile::setLength(uint_least32_t ms)
+{
+    if (!file || (file == &std::cout))
+        return;
+
+    const uint_least64_t bytesPerSec = m_settings.frequency * m_settings.channels * (m_precision / 8);
+    uint_least64_t bytes = sizeof(riffHeader) + sizeof(wavHeader) + (bytesPerSec * ms) / 1000;
+    if (hasListInfo)
+        bytes += sizeof(listInfo);
+    m_preallocated = preallocateFile(name, bytes);
+}
+
+bool WavFile::setLoop(uint_least64_t start, uint_least64_t end)
+{
+    if (!file || (file == &std::cout) || (start >= end))
+        return false;
+
+    hasLoop = true;
+    loopStart = start;
+    loopEnd = end;
+    endian_little32(sampleHdr.samplePeriod, 1000000000UL / m_settings.frequency);
+    endian_little32(sampleHdr.loopStart, start);
+    endian_little32(sampleHdr.loopEnd, end - 1);
+    return true;
+}
+
+bool WavFile::setEnd(uint_least64_t frames)
+{
+    if (!file || (file == &std::cout))
+        return false;
+
+    hasEnd = true;
+    endFrame = frames;
+    return true;
+}
+
+void WavFile::setReplayGain(double gain, double peak)
+{
+    hasReplayGain = true;
+    trackGain = gain;
+    trackPeak = peak;
+}
+
+// LIST INFO chunk with the values in the comment
+void WavFile::addReplayGain(std::vector<char> &trailer) const
+{
+    char comment[96];
+    const int length = std::snprintf(comment, sizeof(comment),
+        "REPLAYGAIN_TRACK_GAIN=%+.2f dB; REPLAYGAIN_TRACK_PEAK=%.6f", trackGain, trackPeak);
+    if (length <= 0)
+        return;
+
+    // include the terminator and pad to an even size
+    const uint_least32_t textLen = length + 1;
+    const uint_least32_t paddedLen = (textLen + 1) & ~1;
+
+    uint8_t header[20];
+    std::memcpy(header, "LIST", 4);
+    endian_little32(header + 4, 4 + 8 + paddedLen);
+    std::memcpy(header + 8, "INFO", 4);
+    std::memcpy(header + 12, "ICMT", 4);
+    endian_little32(header + 16, textLen);
+
+    trailer.insert(trailer.end(), (char*)header, (char*)header + sizeof(header));
+    trailer.insert(trailer.end(), comment, comment + textLen);
+    if (paddedLen != textLen)
+        trailer.push_back(0);
 }
 
 void WavFile::setInfo(const char* title, const char* author, const char* released)
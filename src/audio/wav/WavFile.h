@@ -26,8 +26,10 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include "../AudioBase.h"
+#include "../asyncWriter.h"
 
 struct riffHeader                       // little endian format
 {
@@ -73,6 +75,29 @@ struct listInfo                         // little endian format
     char released[32];
 };
 
+struct sampleInfo                       // little endian format
+{
+    char chunkID[4];                    // 'smpl' (ASCII)
+    unsigned char length[4];            // chunk length, always 60 bytes
+
+    unsigned char manufacturer[4];
+    unsigned char product[4];
+    unsigned char samplePeriod[4];      // nanoseconds per sample
+    unsigned char unityNote[4];         // MIDI note played at the original pitch
+    unsigned char pitchFraction[4];
+    unsigned char smpteFormat[4];
+    unsigned char smpteOffset[4];
+    unsigned char loops[4];             // number of loops, always 1
+    unsigned char samplerData[4];
+
+    unsigned char cuePointID[4];
+    unsigned char loopType[4];          // 0 = forward
+    unsigned char loopStart[4];         // first frame of the loop
+    unsigned char loopEnd[4];           // last frame of the loop
+    unsigned char fraction[4];
+    unsigned char playCount[4];         // 0 = forever
+};
+
 /*
  * A basic WAV output file type
  * Initial implementation by Michael Schwendt <mschwendt@yahoo.com>
@@ -93,14 +118,31 @@ private:
     static const listInfo defaultListInfo;
     listInfo listHdr;
 
+    static const sampleInfo defaultSampleInfo;
+    sampleInfo sampleHdr;
+
     std::ostream *file;
+    asyncWriter *m_writer;
+    unsigned int m_queueDepth;
+    bool m_preallocated;
     bool headerWritten;
     bool hasListInfo;
+    bool hasLoop;
+    uint_least64_t loopStart;
+    uint_least64_t loopEnd;
+    bool hasEnd;
+    uint_least64_t endFrame;
+    bool hasReplayGain;
+    double trackGain;
+    double trackPeak;
     int m_precision;
     int m_channels;
 
+private:
+    void addReplayGain(std::vector<char> &trailer) const;
+
 public:
-    explicit WavFile(const std::string &name);
+    WavFile(const std::string &name, unsigned int queueDepth);
     ~WavFile() override { close(); }
 
     static const char *extension () { return ".wav"; }
@@ -120,6 +162,18 @@ public:
     void pause() override {}
     void reset() override {}
 
+    // Reserve disk space for the given length.
+    void setLength(uint_least32_t ms) override;
+
+    // Add loop points, the data past the loop end is dropped.
+    bool setLoop(uint_least64_t start, uint_least64_t end) override;
+
+    // Drop the data past the end of the song.
+    bool setEnd(uint_least64_t frames) override;
+
+    // Add a ReplayGain comment after the data.
+    void setReplayGain(double gain, double peak) override;
+
     // Stream state.
     bool fail() const { return (file->fail() != 0); }
     bool bad()  const { return (file->bad()  != 0); }
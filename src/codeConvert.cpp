@@ -25,26 +25,28 @@
 
 const char* codeConvert::convert(const char* src)
 {
-    int i=0;
-    while (src[i])
+    const std::size_t length = std::strlen(src);
+
+    // Each character takes at most two bytes
+    buffer.clear();
+    buffer.reserve(length * 2);
+
+    for (std::size_t i = 0; i < length; i++)
     {
         unsigned char ch = static_cast<unsigned char>(src[i]);
         if (ch < 0x80)
-            buffer[i++] = static_cast<char>(ch);
+            buffer.push_back(static_cast<char>(ch));
         else if (ch <= 0xBF)
         {
-            buffer[i++] = static_cast<char>(0xC2);
-            buffer[i++] = static_cast<char>(ch);
+            buffer.push_back(static_cast<char>(0xC2));
+            buffer.push_back(static_cast<char>(ch));
         }
         else
         {
-            buffer[i++] = static_cast<char>(0xC3);
-            buffer[i++] = static_cast<char>(ch - 0x40);
+            buffer.push_back(static_cast<char>(0xC3));
+            buffer.push_back(static_cast<char>(ch - 0x40));
         }
     }
 
-    // terminate buffer string
-    buffer[i] = 0;
-
-    return buffer;
+    return buffer.c_str();
 }
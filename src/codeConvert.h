@@ -21,12 +21,21 @@
 #ifndef CODECONVERT_H
 #define CODECONVERT_H
 
+#include <string>
+
+/**
+ * Convert Latin-1 text to UTF-8.
+ */
 class codeConvert
 {
 private:
-    char buffer[1024];
+    std::string buffer;
 
 public:
+    /**
+     * Convert a string, the result is valid
+     * until the next call.
+     */
     const char* convert(const char* src);
 };
 
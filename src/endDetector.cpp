@@ -0,0 +1,102 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "endDetector.h"
+
+#include <cstring>
+
+/// Peak to peak amplitude still considered silence, about -54 dBFS
+static constexpr int SILENCE_RANGE = 64;
+
+void endDetector::reset(uint_least32_t timeout)
+{
+    m_timeout = timeout;
+    m_silenceStart = 0;
+    m_silent = false;
+    m_lastChange = 0;
+    for (unsigned int i = 0; i < MAX_SIDS; i++)
+        m_hasRegisters[i] = false;
+}
+
+void endDetector::samples(const short *buffer, uint_least32_t frames, unsigned int channels,
+                            uint_least32_t timeMs, uint_least32_t frequency)
+{
+    if (channels > MAX_CHANNELS)
+        return;
+
+    for (uint_least32_t i = 0; i < frames; i++)
+    {
+        bool restart = !m_silent;
+        for (unsigned int c = 0; c < channels; c++)
+        {
+            const int sample = buffer[i * channels + c];
+            if (sample < m_min[c])
+                m_min[c] = sample;
+            if (sample > m_max[c])
+                m_max[c] = sample;
+            if ((m_max[c] - m_min[c]) > SILENCE_RANGE)
+                restart = true;
+        }
+
+        if (restart)
+        {
+            // Start a new stretch from this sample
+            m_silent = true;
+            m_silenceStart = timeMs + static_cast<uint_least32_t>((static_cast<uint_least64_t>(i) * 1000) / frequency);
+            for (unsigned int c = 0; c < channels; c++)
+            {
+                m_min[c] = m_max[c] = buffer[i * channels + c];
+            }
+        }
+    }
+}
+
+void endDetector::registers(unsigned int sid, const uint8_t *regs, uint_least32_t timeMs)
+{
+    if (sid >= MAX_SIDS)
+        return;
+
+    if (!m_hasRegisters[sid] || (std::memcmp(m_registers[sid], regs, SID_REGISTERS) != 0))
+    {
+        std::memcpy(m_registers[sid], regs, SID_REGISTERS);
+        m_hasRegisters[sid] = true;
+        m_lastChange = timeMs;
+    }
+}
+
+bool endDetector::check(uint_least32_t timeMs, uint_least32_t &end) const
+{
+    if (m_timeout == 0)
+        return false;
+
+    if (m_silent && (timeMs >= m_silenceStart) && ((timeMs - m_silenceStart) >= m_timeout))
+    {
+        end = m_silenceStart;
+        return true;
+    }
+
+    if (m_hasRegisters[0] && (timeMs >= m_lastChange) && ((timeMs - m_lastChange) >= m_timeout))
+    {
+        end = m_lastChange;
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,100 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef ENDDETECTOR_H
+#define ENDDETECTOR_H
+
+#include <stdint.h>
+
+/**
+ * Detect the end of a tune, either from sustained silence
+ * in the output or from the player not writing
+ * the SID registers anymore.
+ */
+class endDetector
+{
+public:
+    static constexpr unsigned int MAX_SIDS = 3;
+    static constexpr unsigned int MAX_CHANNELS = 2;
+
+    /// Number of write-only SID registers
+    static constexpr unsigned int SID_REGISTERS = 0x19;
+
+private:
+    /// Detection time in milliseconds, zero when disabled
+    uint_least32_t m_timeout;
+
+    /// Start of the current silent stretch in milliseconds
+    uint_least32_t m_silenceStart;
+    bool m_silent;
+
+    /// Output range during the silent stretch, tolerates a DC offset
+    int m_min[MAX_CHANNELS];
+    int m_max[MAX_CHANNELS];
+
+    /// Time of the last register change in milliseconds
+    uint_least32_t m_lastChange;
+    bool m_hasRegisters[MAX_SIDS];
+    uint8_t m_registers[MAX_SIDS][SID_REGISTERS];
+
+public:
+    endDetector() { reset(0); }
+
+    /**
+     * Restart detection.
+     *
+     * @param timeout detection time in milliseconds, zero to disable
+     */
+    void reset(uint_least32_t timeout);
+
+    bool enabled() const { return m_timeout != 0; }
+
+    /**
+     * Feed the mixed output.
+     *
+     * @param buffer interleaved samples
+     * @param frames number of frames
+     * @param channels number of channels
+     * @param timeMs the time of the first frame in milliseconds
+     * @param frequency the sampling frequency
+     */
+    void samples(const short *buffer, uint_least32_t frames, unsigned int channels,
+                    uint_least32_t timeMs, uint_least32_t frequency);
+
+    /**
+     * Feed the current register contents.
+     *
+     * @param sid the chip number
+     * @param regs the register values
+     * @param timeMs the current time in milliseconds
+     */
+    void registers(unsigned int sid, const uint8_t *regs, uint_least32_t timeMs);
+
+    /**
+     * Check whether the tune has ended.
+     *
+     * @param timeMs the current time in milliseconds
+     * @param end set to the time the tune ended in milliseconds
+     * @return true if the end has been detected
+     */
+    bool check(uint_least32_t timeMs, uint_least32_t &end) const;
+};
+
+#endif // ENDDETECTOR_H
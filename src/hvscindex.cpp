@@ -0,0 +1,720 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+//
+// hvscindex - HVSC metadata catalog
+//
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <fmt/format.h>
+
+#include "filesystem/filesystem.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+
+#include <sidplayfp/SidDatabase.h>
+#include <sidplayfp/SidTune.h>
+#include <sidplayfp/SidTuneInfo.h>
+
+#include "codeConvert.h"
+#include "stilIndex.h"
+#include "tuneBatch.h"
+
+#include "sidcxx11.h"
+
+#undef SEPARATOR
+#define SEPARATOR "/"
+
+namespace fs = ghc::filesystem;
+
+// Change when the index layout changes
+static constexpr uint32_t INDEX_VERSION = 1;
+
+static const char INDEX_MAGIC[8] = { 'S', 'P', 'F', 'H', 'V', 'S', 'C', '\0' };
+
+/*
+ * The index is stored by column: after the header come the
+ * string columns, as offsets into the string pool, then the
+ * numeric columns, the song lengths and finally the pool of
+ * NUL terminated UTF-8 strings. Queries only touch the
+ * columns they filter on.
+ */
+struct indexHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint32_t lengths;
+    uint32_t poolSize;
+};
+
+enum column_t
+{
+    COL_PATH,
+    COL_TITLE,
+    COL_AUTHOR,
+    COL_RELEASED,
+    COL_MD5,
+    COL_STIL,
+    STRING_COLUMNS
+};
+
+static const char *columnNames[STRING_COLUMNS] = { "path", "title", "author", "released", "md5", "stil" };
+
+static const char *clockNames[] = { "unknown", "PAL", "NTSC", "any" };
+static const char *modelNames[] = { "unknown", "6581", "8580", "any" };
+
+constexpr unsigned int MAX_CHIPS = 3;
+
+struct options_t
+{
+    std::string  root;
+    std::string  output = "hvsc.idx";
+    std::string  query;
+    unsigned int threads = 0;
+    bool         verbose = false;
+    std::vector<std::string> filters;
+};
+
+struct entry_t
+{
+    std::string strings[STRING_COLUMNS];
+    uint16_t    songs = 0;
+    uint16_t    startSong = 0;
+    uint8_t     clock = 0;
+    uint8_t     chips = 0;
+    uint8_t     models = 0;
+    bool        valid = false;
+};
+
+/*
+ * Everything shared by the workers.
+ */
+struct context_t
+{
+    options_t                options;
+    std::vector<entry_t>     entries;
+    std::atomic<std::size_t> next;
+    std::mutex               printLock;
+};
+
+static void printUsage(const char *name)
+{
+    fmt::print("Syntax: {} [-<option>...] <directory>\n", name);
+    fmt::print("        {} -q<index> [<column>=<value>...]\n", name);
+    fmt::print("Options:\n"
+        " --help|-h    display this screen\n"
+        " -o<file>     output index (default: hvsc.idx)\n"
+        " -j<num>      number of threads (default: number of cores)\n"
+        " -q<file>     query the index, printing the matching tunes as JSON Lines\n"
+        " -v           print each file while indexing\n"
+        "\n"
+        "Query columns:\n"
+        " path, title, author, released, stil  match a substring, ignoring case\n"
+        " md5                                  match the whole value\n"
+        " songs, chips                         match a number\n"
+        " clock                                PAL, NTSC, any or unknown\n"
+        " model                                6581 or 8580, matches any chip\n"
+        "\n");
+}
+
+static bool parseArgs(int argc, char **argv, options_t &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        if ((arg[0] != '-') || (arg[1] == '\0'))
+        {
+            if (!options.query.empty())
+            {
+                options.filters.push_back(arg);
+                continue;
+            }
+            if (!options.root.empty())
+                return false;
+            options.root = arg;
+        }
+        else if ((std::strcmp(arg, "-h") == 0) || (std::strcmp(arg, "--help") == 0))
+        {
+            return false;
+        }
+        else if (arg[1] == 'o')
+        {
+            if (arg[2] == '\0')
+                return false;
+            options.output = &arg[2];
+        }
+        else if (arg[1] == 'q')
+        {
+            if (arg[2] == '\0')
+                return false;
+            options.query = &arg[2];
+        }
+        else if (arg[1] == 'j')
+        {
+            if (!parseThreads(&arg[2], options.threads))
+                return false;
+        }
+        else if (std::strcmp(arg, "-v") == 0)
+        {
+            options.verbose = true;
+        }
+        else
+        {
+            fmt::print(stderr, "ERROR: Unknown argument: '{}'\n", arg);
+            return false;
+        }
+    }
+
+    return options.query.empty() ? !options.root.empty() : options.root.empty();
+}
+
+static char toLowerAscii(char c)
+{
+    return (c < 'A' || c > 'Z') ? c : c + ('a' - 'A');
+}
+
+static bool equalsNoCase(const char *a, const std::string &b)
+{
+    return (std::strlen(a) == b.size())
+        && std::equal(b.begin(), b.end(), a,
+            [](char x, char y) { return toLowerAscii(x) == toLowerAscii(y); });
+}
+
+/*
+ * List the tunes below the root, sorted by their
+ * HVSC style path.
+ */
+static bool scanTree(context_t &ctx)
+{
+    std::vector<std::string> paths;
+    std::string error;
+    if (!scanTunes(ctx.options.root, paths, error))
+    {
+        fmt::print(stderr, "ERROR: Cannot read directory {}: {}\n", ctx.options.root, error);
+        return false;
+    }
+
+    ctx.entries.resize(paths.size());
+    for (std::size_t i = 0; i < paths.size(); i++)
+        ctx.entries[i].strings[COL_PATH] = std::move(paths[i]);
+    return true;
+}
+
+/*
+ * Read the tune header, only the file itself is needed
+ * so this runs in parallel.
+ */
+static void processTune(context_t &ctx, entry_t &entry, codeConvert &cvt)
+{
+    const std::string file = (fs::path(ctx.options.root) / fs::path(entry.strings[COL_PATH].substr(1))).string();
+    SidTune tune(file.c_str());
+    if (!tune.getStatus())
+    {
+        std::lock_guard<std::mutex> lock(ctx.printLock);
+        fmt::print(stderr, "WARNING: {}: {}\n", entry.strings[COL_PATH], tune.statusString());
+        return;
+    }
+
+    char md5[SidTune::MD5_LENGTH + 1];
+    entry.strings[COL_MD5] = tune.createMD5New(md5);
+
+    const SidTuneInfo *info = tune.getInfo();
+    const unsigned int strings = std::min(info->numberOfInfoStrings(), 3u);
+    for (unsigned int i = 0; i < strings; i++)
+    {
+        // The header strings are Latin-1
+        entry.strings[COL_TITLE + i] = cvt.convert(info->infoString(i));
+    }
+
+    entry.songs = static_cast<uint16_t>(info->songs());
+    entry.startSong = static_cast<uint16_t>(info->startSong());
+    entry.clock = static_cast<uint8_t>(info->clockSpeed()) & 3;
+    entry.chips = static_cast<uint8_t>(std::min<int>(info->sidChips(), MAX_CHIPS));
+    for (unsigned int i = 0; i < entry.chips; i++)
+        entry.models |= (static_cast<uint8_t>(info->sidModel(i)) & 3) << (i * 2);
+    entry.valid = true;
+
+    if (ctx.options.verbose)
+    {
+        std::lock_guard<std::mutex> lock(ctx.printLock);
+        fmt::print(stderr, "{}\n", entry.strings[COL_PATH]);
+    }
+}
+
+static void runWorker(context_t &ctx)
+{
+    codeConvert cvt;
+    for (;;)
+    {
+        const std::size_t index = ctx.next++;
+        if (index >= ctx.entries.size())
+            return;
+        processTune(ctx, ctx.entries[index], cvt);
+    }
+}
+
+static void runWorkers(context_t &ctx)
+{
+    ctx.next = 0;
+    runPool(poolSize(ctx.options.threads, ctx.entries.size()),
+        [&ctx](unsigned int) { runWorker(ctx); });
+}
+
+/*
+ * Strings are stored once, authors and release
+ * years repeat a lot.
+ */
+class stringPool
+{
+private:
+    std::string m_pool;
+    std::unordered_map<std::string, uint32_t> m_offsets;
+
+public:
+    stringPool() : m_pool(1, '\0') {}
+
+    uint32_t add(const std::string &str)
+    {
+        if (str.empty())
+            return 0;
+
+        auto it = m_offsets.find(str);
+        if (it != m_offsets.end())
+            return it->second;
+
+        const uint32_t offset = static_cast<uint32_t>(m_pool.size());
+        m_pool.append(str).push_back('\0');
+        m_offsets.emplace(str, offset);
+        return offset;
+    }
+
+    const std::string &data() const { return m_pool; }
+};
+
+template<typename T>
+static void writeColumn(std::ostream &out, const std::vector<T> &column)
+{
+    out.write(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(T));
+}
+
+static void writePadding(std::ostream &out, std::size_t bytes)
+{
+    static const char zero[4] = { 0, 0, 0, 0 };
+    out.write(zero, (4 - (bytes % 4)) % 4);
+}
+
+/*
+ * Join the songlength database and the STIL, both
+ * looked up from this thread, and write the index.
+ */
+static bool writeIndex(const context_t &ctx, std::ostream &out)
+{
+    const std::string documents = ctx.options.root + SEPARATOR "DOCUMENTS" SEPARATOR;
+
+    SidDatabase database;
+    const bool haveDatabase = database.open((documents + "Songlengths.md5").c_str());
+    if (!haveDatabase)
+        fmt::print(stderr, "WARNING: No songlength database found\n");
+
+    stilIndex stil;
+    const bool haveStil = stil.open(ctx.options.root.c_str());
+    if (!haveStil)
+        fmt::print(stderr, "WARNING: No STIL found\n");
+
+    codeConvert cvt;
+    stringPool pool;
+    std::vector<uint32_t> strings[STRING_COLUMNS];
+    std::vector<uint32_t> firstLength;
+    std::vector<uint16_t> songs, startSong;
+    std::vector<uint8_t> clock, chips, models;
+    std::vector<uint32_t> lengths;
+
+    std::string text;
+    for (const entry_t &entry : ctx.entries)
+    {
+        if (!entry.valid)
+            continue;
+
+        for (int i = 0; i < COL_STIL; i++)
+            strings[i].push_back(pool.add(entry.strings[i]));
+
+        const char *path = entry.strings[COL_PATH].c_str();
+        const bool hasStil = haveStil && stil.getEntry(path, text);
+        strings[COL_STIL].push_back(hasStil ? pool.add(cvt.convert(text.c_str())) : 0);
+
+        firstLength.push_back(static_cast<uint32_t>(lengths.size()));
+        for (unsigned int song = 1; song <= entry.songs; song++)
+        {
+            const int_least32_t length = haveDatabase
+                ? database.lengthMs(entry.strings[COL_MD5].c_str(), song) : -1;
+            lengths.push_back(length > 0 ? static_cast<uint32_t>(length) : 0);
+        }
+
+        songs.push_back(entry.songs);
+        startSong.push_back(entry.startSong);
+        clock.push_back(entry.clock);
+        chips.push_back(entry.chips);
+        models.push_back(entry.models);
+    }
+
+    indexHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.version = INDEX_VERSION;
+    header.count = static_cast<uint32_t>(songs.size());
+    header.lengths = static_cast<uint32_t>(lengths.size());
+    header.poolSize = static_cast<uint32_t>(pool.data().size());
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (int i = 0; i < STRING_COLUMNS; i++)
+        writeColumn(out, strings[i]);
+    writeColumn(out, firstLength);
+    writeColumn(out, songs);
+    writeColumn(out, startSong);
+    writeColumn(out, clock);
+    writeColumn(out, chips);
+    writeColumn(out, models);
+    writePadding(out, header.count * (2 + 2 + 1 + 1 + 1));
+    writeColumn(out, lengths);
+    out.write(pool.data().data(), pool.data().size());
+
+    out.flush();
+    return !out.fail();
+}
+
+/*
+ * Read-only view of a loaded index.
+ */
+struct indexView
+{
+    std::vector<char> data;
+    uint32_t count;
+    const uint32_t *strings[STRING_COLUMNS];
+    const uint32_t *firstLength;
+    const uint16_t *songs;
+    const uint16_t *startSong;
+    const uint8_t *clock;
+    const uint8_t *chips;
+    const uint8_t *models;
+    const uint32_t *lengths;
+    const char *pool;
+
+    const char *string(column_t column, uint32_t i) const { return pool + strings[column][i]; }
+};
+
+static bool loadIndex(const std::string &name, indexView &view)
+{
+    fs::ifstream is(name, std::ios::binary);
+    if (!is.is_open())
+        return false;
+    try
+    {
+        view.data.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+    }
+    catch (std::bad_alloc const &ba)
+    {
+        return false;
+    }
+    if (is.bad() || (view.data.size() < sizeof(indexHeader)))
+        return false;
+
+    indexHeader header;
+    std::memcpy(&header, view.data.data(), sizeof(header));
+    if ((std::memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0) || (header.version != INDEX_VERSION))
+        return false;
+
+    const std::size_t count = header.count;
+    std::size_t numbers = count * (2 + 2 + 1 + 1 + 1);
+    numbers += (4 - (numbers % 4)) % 4;
+    const std::size_t expected = sizeof(header) + count * 4 * (STRING_COLUMNS + 1)
+        + numbers + header.lengths * 4 + header.poolSize;
+    if ((view.data.size() != expected) || (header.poolSize == 0))
+        return false;
+
+    const char *p = view.data.data() + sizeof(header);
+    for (int i = 0; i < STRING_COLUMNS; i++, p += count * 4)
+        view.strings[i] = reinterpret_cast<const uint32_t*>(p);
+    view.firstLength = reinterpret_cast<const uint32_t*>(p); p += count * 4;
+    view.songs = reinterpret_cast<const uint16_t*>(p);       p += count * 2;
+    view.startSong = reinterpret_cast<const uint16_t*>(p);   p += count * 2;
+    view.clock = reinterpret_cast<const uint8_t*>(p);        p += count;
+    view.chips = reinterpret_cast<const uint8_t*>(p);        p += count;
+    view.models = reinterpret_cast<const uint8_t*>(p);       p += count;
+    p += (4 - ((count * 7) % 4)) % 4;
+    view.lengths = reinterpret_cast<const uint32_t*>(p);     p += header.lengths * 4;
+    view.pool = p;
+    view.count = header.count;
+
+    // Don't trust offsets pointing outside the file
+    for (int c = 0; c < STRING_COLUMNS; c++)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (view.strings[c][i] >= header.poolSize)
+                return false;
+        }
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (view.firstLength[i] + view.songs[i] > header.lengths)
+            return false;
+    }
+    return view.pool[header.poolSize - 1] == '\0';
+}
+
+static bool containsNoCase(const char *haystack, const std::string &needle)
+{
+    const std::size_t length = std::strlen(haystack);
+    auto it = std::search(haystack, haystack + length, needle.begin(), needle.end(),
+        [](char a, char b) { return toLowerAscii(a) == toLowerAscii(b); });
+    return it != haystack + length;
+}
+
+/*
+ * Narrow down the candidate rows, one column at a time.
+ */
+static bool applyFilter(const indexView &view, const std::string &filter, std::vector<uint32_t> &rows)
+{
+    const std::size_t sep = filter.find('=');
+    if ((sep == std::string::npos) || (sep == 0))
+        return false;
+
+    std::string column = filter.substr(0, sep);
+    std::transform(column.begin(), column.end(), column.begin(), toLowerAscii);
+    const std::string value = filter.substr(sep + 1);
+
+    std::function<bool(uint32_t)> match;
+
+    for (int c = 0; c < STRING_COLUMNS; c++)
+    {
+        if (column.compare(columnNames[c]) != 0)
+            continue;
+
+        const column_t col = static_cast<column_t>(c);
+        if (col == COL_MD5)
+            match = [&view, value](uint32_t i) { return value.compare(view.string(COL_MD5, i)) == 0; };
+        else
+            match = [&view, value, col](uint32_t i) { return containsNoCase(view.string(col, i), value); };
+    }
+
+    if (!match)
+    {
+        char *end;
+        const long number = std::strtol(value.c_str(), &end, 10);
+        const bool isNumber = (*end == '\0') && !value.empty();
+
+        if ((column.compare("songs") == 0) && isNumber)
+        {
+            match = [&view, number](uint32_t i) { return view.songs[i] == number; };
+        }
+        else if ((column.compare("chips") == 0) && isNumber)
+        {
+            match = [&view, number](uint32_t i) { return view.chips[i] == number; };
+        }
+        else if (column.compare("clock") == 0)
+        {
+            for (unsigned int c = 0; c < 4; c++)
+            {
+                if (equalsNoCase(clockNames[c], value))
+                    match = [&view, c](uint32_t i) { return view.clock[i] == c; };
+            }
+        }
+        else if (column.compare("model") == 0)
+        {
+            for (unsigned int m = 1; m < 3; m++)
+            {
+                if (value.compare(modelNames[m]) != 0)
+                    continue;
+                match = [&view, m](uint32_t i)
+                {
+                    for (unsigned int chip = 0; chip < view.chips[i]; chip++)
+                    {
+                        if (((view.models[i] >> (chip * 2)) & 3) == m)
+                            return true;
+                    }
+                    return false;
+                };
+            }
+        }
+    }
+
+    if (!match)
+        return false;
+
+    rows.erase(std::remove_if(rows.begin(), rows.end(),
+        [&match](uint32_t i) { return !match(i); }), rows.end());
+    return true;
+}
+
+// Append a JSON string literal
+static void appendJson(std::string &out, const char *str)
+{
+    out.push_back('"');
+    for (; *str; str++)
+    {
+        const unsigned char ch = static_cast<unsigned char>(*str);
+        switch (ch)
+        {
+            case '"':  out.append("\\\""); break;
+            case '\\': out.append("\\\\"); break;
+            case '\n': out.append("\\n"); break;
+            case '\r': out.append("\\r"); break;
+            case '\t': out.append("\\t"); break;
+            default:
+                if (ch < 0x20)
+                    out.append(fmt::format("\\u{:04x}", ch));
+                else
+                    out.push_back(static_cast<char>(ch));
+                break;
+        }
+    }
+    out.push_back('"');
+}
+
+static int runQuery(const options_t &options)
+{
+    indexView view;
+    if (!loadIndex(options.query, view))
+    {
+        fmt::print(stderr, "ERROR: {} is not a valid index\n", options.query);
+        return EXIT_FAILURE;
+    }
+
+    std::vector<uint32_t> rows(view.count);
+    for (uint32_t i = 0; i < view.count; i++)
+        rows[i] = i;
+
+    for (const std::string &filter : options.filters)
+    {
+        if (!applyFilter(view, filter, rows))
+        {
+            fmt::print(stderr, "ERROR: Invalid filter: '{}'\n", filter);
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::string out;
+    for (const uint32_t i : rows)
+    {
+        out.assign("{");
+        for (int c = 0; c < STRING_COLUMNS; c++)
+        {
+            if (c != 0)
+                out.push_back(',');
+            out.append(fmt::format("\"{}\":", columnNames[c]));
+            const column_t col = static_cast<column_t>(c);
+            if ((col == COL_STIL) && (view.strings[col][i] == 0))
+                out.append("null");
+            else
+                appendJson(out, view.string(col, i));
+        }
+
+        out.append(fmt::format(",\"songs\":{},\"startSong\":{},\"clock\":\"{}\",\"models\":[",
+            view.songs[i], view.startSong[i], clockNames[view.clock[i] & 3]));
+        for (unsigned int chip = 0; chip < view.chips[i]; chip++)
+            out.append(fmt::format("{}\"{}\"", chip ? "," : "", modelNames[(view.models[i] >> (chip * 2)) & 3]));
+
+        // Lengths in milliseconds, null if unknown
+        out.append("],\"lengths\":[");
+        for (unsigned int song = 0; song < view.songs[i]; song++)
+        {
+            const uint32_t length = view.lengths[view.firstLength[i] + song];
+            if (song != 0)
+                out.push_back(',');
+            if (length != 0)
+                out.append(fmt::format("{}", length));
+            else
+                out.append("null");
+        }
+        out.append("]}\n");
+
+        std::fwrite(out.data(), 1, out.size(), stdout);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    context_t ctx;
+
+    if (!parseArgs(argc, argv, ctx.options))
+    {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (!ctx.options.query.empty())
+        return runQuery(ctx.options);
+
+    while ((ctx.options.root.size() > 1) && (ctx.options.root.back() == '/'))
+        ctx.options.root.pop_back();
+
+    if (!scanTree(ctx))
+        return EXIT_FAILURE;
+
+    const auto startTime = std::chrono::steady_clock::now();
+    runWorkers(ctx);
+
+    // Write a temporary file first, a failed run
+    // leaves the previous index untouched
+    const std::string tmpName = ctx.options.output + ".tmp";
+    bool ok;
+    {
+        fs::ofstream out(tmpName, std::ios::out | std::ios::binary | std::ios::trunc);
+        ok = out.is_open() && writeIndex(ctx, out);
+    }
+    std::error_code ec;
+    if (ok)
+        fs::rename(tmpName, ctx.options.output, ec);
+    if (!ok || ec)
+    {
+        fs::remove(tmpName, ec);
+        fmt::print(stderr, "ERROR: Cannot write {}\n", ctx.options.output);
+        return EXIT_FAILURE;
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+
+    const std::size_t indexed = std::count_if(ctx.entries.begin(), ctx.entries.end(),
+        [](const entry_t &entry) { return entry.valid; });
+    fmt::print(stderr, "{} of {} files indexed in {:.1f}s\n", indexed, ctx.entries.size(), elapsed.count());
+
+    return EXIT_SUCCESS;
+}
@@ -21,6 +21,7 @@
 #include <cstdlib>
 
 #include <algorithm>
+#include <utility>
 
 #ifdef _WIN32
 #  include <windows.h>
@@ -29,18 +30,6 @@
 
 namespace fs = ghc::filesystem;
 
-template<class T>
-class compare
-{
-private:
-    std::string s;
-
-public:
-    explicit compare(const char *str) : s(str) {}
-
-    bool operator () (T const &p) { return s.compare(p.first) == 0; }
-};
-
 //
 
 iniHandler::iniHandler() :
@@ -79,6 +68,24 @@ iniHandler::stringPair_t iniHandler::parseKey(const std::string &buffer)
     return make_pair(key, value);
 }
 
+void iniHandler::indexKeys(section_t &section)
+{
+    section.index.clear();
+    for (std::size_t i = 0; i < section.keys.size(); i++)
+    {
+        // Skip comments, keep the first of duplicated keys
+        if (!section.keys[i].first.empty())
+            section.index.emplace(section.keys[i].first, i);
+    }
+}
+
+void iniHandler::indexSections()
+{
+    sectionIndex.clear();
+    for (std::size_t i = 0; i < sections.size(); i++)
+        sectionIndex.emplace(sections[i].name, i);
+}
+
 bool iniHandler::open(const fs::path &fName)
 {
     if (tryOpen(fName))
@@ -115,16 +122,17 @@ bool iniHandler::tryOpen(const fs::path &fName)
             if (!sections.empty())
             {
                 sections_t::reference lastSect(sections.back());
-                lastSect.second.push_back(make_pair(std::string(), buffer));
+                lastSect.keys.push_back(make_pair(std::string(), buffer));
             }
             break;
 
         case '[':
             try
             {
-                const std::string section = parseSection(buffer);
-                const keys_t keys;
-                sections.push_back(make_pair(section, keys));
+                section_t section;
+                section.name = parseSection(buffer);
+                sectionIndex.emplace(section.name, sections.size());
+                sections.push_back(std::move(section));
             }
             catch (parseError const &e) {}
 
@@ -136,7 +144,9 @@ bool iniHandler::tryOpen(const fs::path &fName)
                 if (!sections.empty()) //FIXME add a default section?
                 {
                     sections_t::reference lastSect(sections.back());
-                    lastSect.second.push_back(parseKey(buffer));
+                    lastSect.keys.push_back(parseKey(buffer));
+                    if (!lastSect.keys.back().first.empty())
+                        lastSect.index.emplace(lastSect.keys.back().first, lastSect.keys.size() - 1);
                 }
             }
             catch (parseError const &e) {}
@@ -156,38 +166,50 @@ void iniHandler::close()
     }
 
     sections.clear();
+    sectionIndex.clear();
     changed = false;
 }
 
 bool iniHandler::setSection(const char *section)
 {
-    curSection = std::find_if(sections.begin(), sections.end(), compare<keyPair_t>(section));
+    index_t::const_iterator it = sectionIndex.find(section);
+    curSection = (it != sectionIndex.end()) ? sections.begin() + it->second : sections.end();
     return (curSection != sections.end());
 }
 
 const char *iniHandler::getValue(const char *key) const
 {
-    keys_t::const_iterator keyIt = std::find_if((*curSection).second.begin(), (*curSection).second.end(), compare<stringPair_t>(key));
-    return (keyIt != (*curSection).second.end()) ? keyIt->second.c_str() : nullptr;
+    index_t::const_iterator it = (*curSection).index.find(key);
+    return (it != (*curSection).index.end()) ? (*curSection).keys[it->second].second.c_str() : nullptr;
 }
 
 void iniHandler::addSection(const char *section)
 {
-    const keys_t keys;
-    curSection = sections.insert(curSection, make_pair(section, keys));
+    section_t newSection;
+    newSection.name = section;
+    curSection = sections.insert(curSection, std::move(newSection));
+    // Following sections have moved
+    const std::size_t pos = curSection - sections.begin();
+    indexSections();
+    curSection = sections.begin() + pos;
     changed = true;
 }
 
 void iniHandler::addValue(const char *key, const char *value)
 {
-    (*curSection).second.push_back(make_pair(std::string(key), std::string(value)));
+    keys_t &keys = (*curSection).keys;
+    keys.push_back(make_pair(std::string(key), std::string(value)));
+    (*curSection).index.emplace(keys.back().first, keys.size() - 1);
     changed = true;
 }
 
 void iniHandler::removeValue(const char *key)
 {
-    auto section = &(*curSection).second;
-    section->erase(std::remove_if(section->begin(), section->end(), compare<stringPair_t>(key)));
+    keys_t &keys = (*curSection).keys;
+    const std::string name(key);
+    keys.erase(std::remove_if(keys.begin(), keys.end(),
+        [&name](stringPair_t const &p) { return name.compare(p.first) == 0; }), keys.end());
+    indexKeys(*curSection);
     changed = true;
 }
 
@@ -202,9 +224,9 @@ bool iniHandler::write(const fs::path &fName)
 
     for (auto & section : sections)
     {
-        iniFile << "[" << section.first << "]" << std::endl;
+        iniFile << "[" << section.name << "]" << std::endl;
 
-        for (keys_t::iterator entry = section.second.begin(); entry != section.second.end(); ++entry)
+        for (keys_t::iterator entry = section.keys.begin(); entry != section.keys.end(); ++entry)
         {
             const std::string key = (*entry).first;
             if (!key.empty())
@@ -22,8 +22,11 @@
 #include "filesystem/filesystem.hpp"
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include <cstddef>
+
 namespace fs = ghc::filesystem;
 
 class iniHandler
@@ -32,13 +35,22 @@ private:
     using stringPair_t = std::pair<std::string, std::string>;
     using keys_t = std::vector<stringPair_t>;
 
-    using keyPair_t = std::pair<std::string, keys_t>;
-    using sections_t = std::vector<keyPair_t>;
+    // Position of the first entry with a given name
+    using index_t = std::unordered_map<std::string, std::size_t>;
+
+    struct section_t
+    {
+        std::string name;
+        keys_t keys;
+        index_t index;
+    };
+    using sections_t = std::vector<section_t>;
 
     class parseError {};
 
 private:
     sections_t sections;
+    index_t sectionIndex;
 
     sections_t::iterator curSection;
 
@@ -51,6 +63,9 @@ private:
 
     static stringPair_t parseKey(const std::string &buffer);
 
+    static void indexKeys(section_t &section);
+    void indexSections();
+
 public:
     iniHandler();
     ~iniHandler();
@@ -23,12 +23,17 @@
 
 #include "sidcxx11.h"
 
-#ifndef _WIN32
+#ifdef _WIN32
+#  include <windows.h>
+#else
 // Unix console headers
 #  include <cctype>
+#  include <cerrno>
+#  include <csignal>
 // bzero requires memset on some platforms
 #  include <cstring>
 #  include <fcntl.h>
+#  include <poll.h>
 #  include <sys/stat.h>
 #  include <sys/time.h>
 #  include <sys/types.h>
@@ -230,11 +235,72 @@ int keyboard_decode ()
     return action;
 }
 
+#ifdef _WIN32
+
+bool keyboard_wait ()
+{
+    // The console handle is signaled for any input event,
+    // the timeout bounds the latency of the console control handler
+    WaitForSingleObject (GetStdHandle (STD_INPUT_HANDLE), 100);
+    return _kbhit ();
+}
+
+void keyboard_wakeup () {}
+
+#else
+
 // Simulate Standard Microsoft Extensions under Unix
-#ifndef _WIN32
 
 static int infd = -1;
 
+// Self-pipe written by the signal handlers to wake up poll
+static int wakefd[2] = { -1, -1 };
+static volatile sig_atomic_t wakeWrite = -1;
+
+bool keyboard_wait ()
+{
+    struct pollfd fds[2];
+    nfds_t count = 0;
+    if (infd >= 0)
+    {
+        fds[count].fd = infd;
+        fds[count++].events = POLLIN;
+    }
+    if (wakefd[0] >= 0)
+    {
+        fds[count].fd = wakefd[0];
+        fds[count++].events = POLLIN;
+    }
+
+    // Without a terminal there is nothing to wait for
+    // but the signals, check the state now and then
+    const int timeout = (infd >= 0) ? -1 : 100;
+    if (poll (fds, count, timeout) <= 0)
+        return false;
+
+    if ((wakefd[0] >= 0) && (fds[count - 1].revents & POLLIN))
+    {   // Drain the pipe
+        char buffer[16];
+        while (read (wakefd[0], buffer, sizeof (buffer)) > 0)
+            continue;
+    }
+
+    return (infd >= 0) && (fds[0].revents & POLLIN);
+}
+
+void keyboard_wakeup ()
+{
+    const int fd = wakeWrite;
+    if (fd >= 0)
+    {   // Keep errno unchanged for the interrupted code
+        const int savedErrno = errno;
+        const char ch = 0;
+        ssize_t res = write (fd, &ch, 1);
+        (void)res;
+        errno = savedErrno;
+    }
+}
+
 int _kbhit (void)
 {
     if (infd >= 0)
@@ -295,6 +361,22 @@ void keyboard_enable_raw ()
     current.c_cc[VMIN] = 1;
     current.c_cc[VTIME] = 0;
     tcsetattr (infd, TCSAFLUSH, &current);
+
+    // Non blocking so that neither the signal handler
+    // nor draining the pipe can get stuck
+    if (pipe (wakefd) == 0)
+    {
+        for (int fd : wakefd)
+        {
+            fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK);
+            fcntl (fd, F_SETFD, FD_CLOEXEC);
+        }
+        wakeWrite = wakefd[1];
+    }
+    else
+    {
+        wakefd[0] = wakefd[1] = -1;
+    }
 }
 
 void keyboard_disable_raw ()
@@ -312,6 +394,14 @@ void keyboard_disable_raw ()
         }
         infd = -1;
     }
+
+    if (wakefd[0] >= 0)
+    {
+        wakeWrite = -1;
+        close (wakefd[0]);
+        close (wakefd[1]);
+        wakefd[0] = wakefd[1] = -1;
+    }
 }
 
 #endif // HAVE_LINUX
@@ -71,3 +71,14 @@ int  keyboard_decode      ();
 void keyboard_enable_raw  ();
 void keyboard_disable_raw ();
 #endif
+
+/*
+ * Sleep until a key is pressed or keyboard_wakeup is called,
+ * returns true if a key is available.
+ */
+bool keyboard_wait        ();
+
+/*
+ * Interrupt keyboard_wait, safe to call from a signal handler.
+ */
+void keyboard_wakeup      ();
@@ -0,0 +1,144 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+
+#include "loopDetector.h"
+
+// FNV-1a
+static constexpr uint_least64_t HASH_OFFSET = 0xcbf29ce484222325ULL;
+static constexpr uint_least64_t HASH_PRIME = 0x100000001b3ULL;
+
+// Multiplier for the rolling hash over the window
+static constexpr uint_least64_t WINDOW_BASE = 0x9e3779b97f4a7c15ULL;
+
+/// Candidate periods checked at once
+static constexpr unsigned int MAX_CANDIDATES = 8;
+
+static uint_least64_t windowPower()
+{
+    uint_least64_t power = 1;
+    for (unsigned int i = 0; i < loopDetector::WINDOW; i++)
+        power *= WINDOW_BASE;
+    return power;
+}
+
+void loopDetector::reset(bool enable)
+{
+    m_enabled = enable;
+    m_frameHash = HASH_OFFSET;
+    m_hashes.clear();
+    m_positions.clear();
+    m_windowHash = 0;
+    m_windows.clear();
+    m_candidates.clear();
+    m_found = false;
+    m_loopStart = 0;
+    m_loopEnd = 0;
+}
+
+void loopDetector::registers(unsigned int sid, const uint8_t *regs)
+{
+    if (sid >= MAX_SIDS)
+        return;
+
+    uint_least64_t hash = m_frameHash ^ sid;
+    for (unsigned int i = 0; i < SID_REGISTERS; i++)
+    {
+        hash ^= regs[i];
+        hash *= HASH_PRIME;
+    }
+    m_frameHash = hash;
+}
+
+bool loopDetector::endFrame(uint_least64_t position)
+{
+    if (!m_enabled || m_found)
+        return false;
+
+    const uint_least64_t hash = m_frameHash;
+    m_frameHash = HASH_OFFSET;
+
+    const uint_least32_t frame = m_hashes.size();
+    m_hashes.push_back(hash);
+    m_positions.push_back(position);
+
+    // Follow the periods being checked
+    for (auto it = m_candidates.begin(); it != m_candidates.end(); )
+    {
+        if (m_hashes[frame - it->period] != hash)
+        {
+            it = m_candidates.erase(it);
+            continue;
+        }
+
+        if (++it->matched >= it->period)
+        {
+            confirm(frame, it->period);
+            return true;
+        }
+        ++it;
+    }
+
+    static const uint_least64_t power = windowPower();
+    m_windowHash = m_windowHash * WINDOW_BASE + hash;
+    if (frame < WINDOW)
+        return false;
+    m_windowHash -= m_hashes[frame - WINDOW] * power;
+
+    auto window = m_windows.find(m_windowHash);
+    if (window == m_windows.end())
+    {
+        m_windows.emplace(m_windowHash, frame);
+        return false;
+    }
+
+    const uint_least32_t period = frame - window->second;
+    window->second = frame;
+    if ((period < MIN_PERIOD) || (m_candidates.size() >= MAX_CANDIDATES))
+        return false;
+
+    for (const candidate &c : m_candidates)
+    {
+        if (c.period == period)
+            return false;
+    }
+
+    m_candidates.push_back(candidate { period, 0 });
+    return false;
+}
+
+void loopDetector::confirm(uint_least32_t frame, uint_least32_t period)
+{
+    // Go back to the earliest frame that repeats
+    uint_least32_t start = frame - period;
+    while ((start > 0) && (m_hashes[start - 1] == m_hashes[start - 1 + period]))
+        start--;
+
+    // The state at the end of a frame is the same,
+    // so the output repeats from there on
+    m_loopStart = m_positions[start];
+    m_loopEnd = m_positions[start + period];
+    m_found = true;
+
+    m_hashes.clear();
+    m_positions.clear();
+    m_windows.clear();
+    m_candidates.clear();
+}
@@ -0,0 +1,120 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+
+#ifndef LOOPDETECTOR_H
+#define LOOPDETECTOR_H
+
+#include <unordered_map>
+#include <vector>
+
+#include <stdint.h>
+
+/**
+ * Find where a tune starts repeating itself.
+ *
+ * The contents of the SID registers are hashed once per frame,
+ * a loop is found when a stretch of frames repeats for a whole
+ * period. The loop is then extended backwards as far as
+ * the frames keep matching, to find where it first starts.
+ */
+class loopDetector
+{
+public:
+    static constexpr unsigned int MAX_SIDS = 3;
+
+    /// Number of write-only SID registers
+    static constexpr unsigned int SID_REGISTERS = 0x19;
+
+    /// Frames that must match to start checking a period
+    static constexpr unsigned int WINDOW = 16;
+
+    /// Shortest loop in frames, avoids mistaking held notes for loops
+    static constexpr unsigned int MIN_PERIOD = 64;
+
+private:
+    struct candidate
+    {
+        uint_least32_t period;
+        uint_least32_t matched;
+    };
+
+private:
+    bool m_enabled;
+
+    uint_least64_t m_frameHash;
+
+    /// Hash and end position of every frame
+    std::vector<uint_least64_t> m_hashes;
+    std::vector<uint_least64_t> m_positions;
+
+    /// Rolling hash of the last WINDOW frames
+    uint_least64_t m_windowHash;
+
+    /// Last frame ending each window seen so far
+    std::unordered_map<uint_least64_t, uint_least32_t> m_windows;
+
+    std::vector<candidate> m_candidates;
+
+    bool m_found;
+    uint_least64_t m_loopStart;
+    uint_least64_t m_loopEnd;
+
+private:
+    void confirm(uint_least32_t frame, uint_least32_t period);
+
+public:
+    loopDetector() { reset(false); }
+
+    /**
+     * Restart detection.
+     *
+     * @param enable whether to look for loops
+     */
+    void reset(bool enable);
+
+    bool enabled() const { return m_enabled; }
+
+    /**
+     * Feed the current register contents.
+     *
+     * @param sid the chip number
+     * @param regs the register values
+     */
+    void registers(unsigned int sid, const uint8_t *regs);
+
+    /**
+     * Complete the current frame.
+     *
+     * @param position the output position at the end of the frame
+     * @return true if the loop has been found in this frame
+     */
+    bool endFrame(uint_least64_t position);
+
+    bool found() const { return m_found; }
+
+    /// Position where the loop starts
+    uint_least64_t loopStart() const { return m_loopStart; }
+
+    /// Position where the loop ends and the next one starts
+    uint_least64_t loopEnd() const { return m_loopEnd; }
+};
+
+#endif // LOOPDETECTOR_H
@@ -0,0 +1,385 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "loudness.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifndef M_PI
+#  define M_PI 3.14159265358979323846
+#endif
+
+/// Steps of 100 ms in a short-term window
+static constexpr unsigned int SHORT_TERM_STEPS = 30;
+
+/// Steps of 100 ms in a gating block
+static constexpr unsigned int BLOCK_STEPS = 4;
+
+static constexpr double ABSOLUTE_GATE = -70.;
+static constexpr double RELATIVE_GATE = -10.;
+static constexpr double RANGE_GATE = -20.;
+
+static double toLoudness(double power)
+{
+    return -0.691 + 10. * std::log10(power);
+}
+
+static double toPower(double loudness)
+{
+    return std::pow(10., (loudness + 0.691) / 10.);
+}
+
+/*
+ * Mean power of the blocks above the absolute gate
+ * and the given gate relative to their loudness.
+ */
+static double gatedPower(const std::vector<double> &blocks, double relativeGate)
+{
+    const double absolute = toPower(ABSOLUTE_GATE);
+
+    double sum = 0.;
+    unsigned int count = 0;
+    for (double power : blocks)
+    {
+        if (power > absolute)
+        {
+            sum += power;
+            count++;
+        }
+    }
+    if (count == 0)
+        return 0.;
+
+    const double relative = toPower(toLoudness(sum / count) + relativeGate);
+    const double gate = std::max(absolute, relative);
+
+    sum = 0.;
+    count = 0;
+    for (double power : blocks)
+    {
+        if (power > gate)
+        {
+            sum += power;
+            count++;
+        }
+    }
+    return count ? sum / count : 0.;
+}
+
+void loudnessMeter::reset(uint_least32_t frequency, unsigned int channels)
+{
+    m_enabled = (channels > 0) && (channels <= MAX_CHANNELS) && (frequency > 0);
+    if (!m_enabled)
+        return;
+
+    m_channels = channels;
+
+    // K-weighting, the pre-filter is a high shelf
+    // and the RLB filter a high pass
+    {
+        const double f0 = 1681.974450955533;
+        const double gain = 3.999843853973347;
+        const double q = 0.7071752369554196;
+
+        const double k = std::tan(M_PI * f0 / frequency);
+        const double vh = std::pow(10., gain / 20.);
+        const double vb = std::pow(vh, 0.4996667741545416);
+        const double a0 = 1. + k / q + k * k;
+
+        m_shelf.b0 = (vh + vb * k / q + k * k) / a0;
+        m_shelf.b1 = 2. * (k * k - vh) / a0;
+        m_shelf.b2 = (vh - vb * k / q + k * k) / a0;
+        m_shelf.a1 = 2. * (k * k - 1.) / a0;
+        m_shelf.a2 = (1. - k / q + k * k) / a0;
+    }
+    {
+        const double f0 = 38.13547087602444;
+        const double q = 0.5003270373238773;
+
+        const double k = std::tan(M_PI * f0 / frequency);
+        const double a0 = 1. + k / q + k * k;
+
+        m_highpass.b0 = 1.;
+        m_highpass.b1 = -2.;
+        m_highpass.b2 = 1.;
+        m_highpass.a1 = 2. * (k * k - 1.) / a0;
+        m_highpass.a2 = (1. - k / q + k * k) / a0;
+    }
+
+    // Hann windowed sinc interpolator, each phase
+    // is normalized to unity gain
+    m_tapsGain = 0.f;
+    for (unsigned int phase = 0; phase < OVERSAMPLING; phase++)
+    {
+        double sum = 0.;
+        for (unsigned int tap = 0; tap < PHASE_TAPS; tap++)
+        {
+            const unsigned int n = tap * OVERSAMPLING + phase;
+            const double length = OVERSAMPLING * PHASE_TAPS;
+            const double x = (n - (length - 1.) / 2.) / OVERSAMPLING;
+            const double sinc = (x == 0.) ? 1. : std::sin(M_PI * x) / (M_PI * x);
+            const double window = 0.5 - 0.5 * std::cos(2. * M_PI * (n + 0.5) / length);
+            m_taps[phase][tap] = sinc * window;
+            sum += m_taps[phase][tap];
+        }
+        float gain = 0.f;
+        for (unsigned int tap = 0; tap < PHASE_TAPS; tap++)
+        {
+            m_taps[phase][tap] /= sum;
+            gain += std::fabs(m_taps[phase][tap]);
+        }
+        m_tapsGain = std::max(m_tapsGain, gain);
+    }
+
+    for (unsigned int c = 0; c < MAX_CHANNELS; c++)
+    {
+        channel &state = m_state[c];
+        state.z1[0] = state.z1[1] = 0.;
+        state.z2[0] = state.z2[1] = 0.;
+        std::fill(state.input, state.input + HISTORY + BLOCK, 0.f);
+    }
+
+    m_stepLength = (frequency + 5) / 10;
+    m_stepFrames = 0;
+    m_stepPower = 0.;
+    m_steps.assign(SHORT_TERM_STEPS, 0.);
+    m_stepCount = 0;
+    m_blocks.clear();
+    m_shortTerm.clear();
+    m_peak = 0.f;
+    m_truePeak = 0.f;
+}
+
+void loudnessMeter::reserve(uint_least32_t ms)
+{
+    // One value per step, the first ones are skipped
+    const std::size_t steps = ms / 100 + 1;
+    m_blocks.reserve(steps);
+    m_shortTerm.reserve(steps);
+}
+
+void loudnessMeter::samples(const short *buffer, uint_least32_t frames)
+{
+    if (!m_enabled)
+        return;
+
+    while (frames > 0)
+    {
+        const unsigned int length = std::min<uint_least32_t>(
+            std::min<uint_least32_t>(frames, BLOCK), m_stepLength - m_stepFrames);
+
+        for (unsigned int c = 0; c < m_channels; c++)
+        {
+            float *input = m_state[c].input + HISTORY;
+            for (unsigned int i = 0; i < length; i++)
+                input[i] = buffer[i * m_channels + c] * (1.f / 32768.f);
+        }
+
+        processBlock(length);
+
+        buffer += length * m_channels;
+        frames -= length;
+        m_stepFrames += length;
+        if (m_stepFrames == m_stepLength)
+            endStep();
+    }
+}
+
+/*
+ * K-weighting, transposed direct form II. The filters are
+ * recursive so the channels are run side by side to overlap
+ * their dependency chains.
+ */
+template <unsigned int CHANNELS>
+void loudnessMeter::weight(unsigned int frames)
+{
+    const biquad shelf = m_shelf;
+    const biquad highpass = m_highpass;
+
+    double s1[CHANNELS], s2[CHANNELS], h1[CHANNELS], h2[CHANNELS], power[CHANNELS];
+    for (unsigned int c = 0; c < CHANNELS; c++)
+    {
+        s1[c] = m_state[c].z1[0]; s2[c] = m_state[c].z2[0];
+        h1[c] = m_state[c].z1[1]; h2[c] = m_state[c].z2[1];
+        power[c] = 0.;
+    }
+
+    for (unsigned int i = 0; i < frames; i++)
+    {
+        for (unsigned int c = 0; c < CHANNELS; c++)
+        {
+            const double x = m_state[c].input[HISTORY + i];
+            const double y = shelf.b0 * x + s1[c];
+            s1[c] = shelf.b1 * x - shelf.a1 * y + s2[c];
+            s2[c] = shelf.b2 * x - shelf.a2 * y;
+
+            const double w = highpass.b0 * y + h1[c];
+            h1[c] = highpass.b1 * y - highpass.a1 * w + h2[c];
+            h2[c] = highpass.b2 * y - highpass.a2 * w;
+            power[c] += w * w;
+        }
+    }
+
+    for (unsigned int c = 0; c < CHANNELS; c++)
+    {
+        m_state[c].z1[0] = s1[c]; m_state[c].z2[0] = s2[c];
+        m_state[c].z1[1] = h1[c]; m_state[c].z2[1] = h2[c];
+        m_stepPower += power[c];
+    }
+}
+
+/*
+ * Interpolate one phase at a time. The loops always run over
+ * a whole block, past the end there are just stale samples,
+ * so that the compiler can vectorize them without
+ * scalar prologues and epilogues.
+ */
+void loudnessMeter::truePeak(const float *input, unsigned int frames)
+{
+    float oversampled[BLOCK];
+    float peaks[BLOCK];
+    std::fill(peaks, peaks + BLOCK, 0.f);
+
+    for (unsigned int phase = 0; phase < OVERSAMPLING; phase++)
+    {
+        const float *taps = m_taps[phase];
+        for (unsigned int i = 0; i < BLOCK; i++)
+            oversampled[i] = taps[0] * input[HISTORY + i];
+        for (unsigned int tap = 1; tap < PHASE_TAPS; tap++)
+        {
+            const float coeff = taps[tap];
+            const float *x = input + HISTORY - tap;
+            for (unsigned int i = 0; i < BLOCK; i++)
+                oversampled[i] += coeff * x[i];
+        }
+        std::fill(oversampled + frames, oversampled + BLOCK, 0.f);
+        for (unsigned int i = 0; i < BLOCK; i++)
+        {
+            const float sample = std::fabs(oversampled[i]);
+            peaks[i] = (sample > peaks[i]) ? sample : peaks[i];
+        }
+    }
+
+    // Fold the lanes in halves down to a few values
+    unsigned int width = BLOCK / 2;
+    for (; width >= 4; width /= 2)
+    {
+        for (unsigned int i = 0; i < width; i++)
+            peaks[i] = (peaks[i + width] > peaks[i]) ? peaks[i + width] : peaks[i];
+    }
+
+    float truePeak = m_truePeak;
+    for (unsigned int i = 0; i < width * 2; i++)
+        truePeak = std::max(truePeak, peaks[i]);
+    m_truePeak = truePeak;
+}
+
+void loudnessMeter::processBlock(unsigned int frames)
+{
+    if (m_channels == 2)
+        weight<2>(frames);
+    else
+        weight<1>(frames);
+
+    for (unsigned int c = 0; c < m_channels; c++)
+    {
+        float *input = m_state[c].input;
+
+        // The history is included as it's used by the interpolator
+        float peak = 0.f;
+        for (unsigned int i = 0; i < HISTORY + frames; i++)
+            peak = std::max(peak, std::fabs(input[i]));
+        m_peak = std::max(m_peak, peak);
+
+        // Skip the interpolation if the block can't
+        // get above the current true peak
+        if (peak * m_tapsGain > m_truePeak)
+            truePeak(input, frames);
+
+        // Keep the tail for the next block
+        std::copy(input + frames, input + frames + HISTORY, input);
+    }
+}
+
+void loudnessMeter::endStep()
+{
+    m_steps[m_stepCount % SHORT_TERM_STEPS] = m_stepPower / m_stepLength;
+    m_stepCount++;
+    m_stepFrames = 0;
+    m_stepPower = 0.;
+
+    // Gating blocks overlap by 75%
+    if (m_stepCount >= BLOCK_STEPS)
+    {
+        double power = 0.;
+        for (unsigned int i = 1; i <= BLOCK_STEPS; i++)
+            power += m_steps[(m_stepCount - i) % SHORT_TERM_STEPS];
+        m_blocks.push_back(power / BLOCK_STEPS);
+    }
+
+    if (m_stepCount >= SHORT_TERM_STEPS)
+    {
+        double power = 0.;
+        for (double step : m_steps)
+            power += step;
+        m_shortTerm.push_back(power / SHORT_TERM_STEPS);
+    }
+}
+
+double loudnessMeter::integrated() const
+{
+    const double power = gatedPower(m_blocks, RELATIVE_GATE);
+    return (power > 0.) ? toLoudness(power) : -HUGE_VAL;
+}
+
+double loudnessMeter::range() const
+{
+    const double absolute = toPower(ABSOLUTE_GATE);
+
+    double sum = 0.;
+    unsigned int count = 0;
+    for (double power : m_shortTerm)
+    {
+        if (power > absolute)
+        {
+            sum += power;
+            count++;
+        }
+    }
+    if (count == 0)
+        return 0.;
+
+    const double gate = toPower(toLoudness(sum / count) + RANGE_GATE);
+
+    std::vector<double> gated;
+    for (double power : m_shortTerm)
+    {
+        if ((power > absolute) && (power > gate))
+            gated.push_back(power);
+    }
+    if (gated.empty())
+        return 0.;
+
+    std::sort(gated.begin(), gated.end());
+    const double low = gated[static_cast<std::size_t>(0.10 * (gated.size() - 1) + 0.5)];
+    const double high = gated[static_cast<std::size_t>(0.95 * (gated.size() - 1) + 0.5)];
+    return toLoudness(high) - toLoudness(low);
+}
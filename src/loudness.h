@@ -0,0 +1,147 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef LOUDNESS_H
+#define LOUDNESS_H
+
+#include <vector>
+
+#include <stdint.h>
+
+/**
+ * Loudness and true peak measurement as specified
+ * in ITU-R BS.1770-4 and EBU Tech 3341/3342.
+ *
+ * The samples are K-weighted and their power is summed
+ * in 100 ms steps, the gating blocks of 400 ms and
+ * the 3 s short-term windows are built from these.
+ * The true peak is taken on a four times oversampled signal.
+ */
+class loudnessMeter
+{
+public:
+    static constexpr unsigned int MAX_CHANNELS = 2;
+
+private:
+    /// Frames processed at once
+    static constexpr unsigned int BLOCK = 256;
+
+    static constexpr unsigned int OVERSAMPLING = 4;
+    static constexpr unsigned int PHASE_TAPS = 12;
+
+    /// Previous input samples needed by the interpolator
+    static constexpr unsigned int HISTORY = PHASE_TAPS - 1;
+
+    struct biquad
+    {
+        double b0, b1, b2, a1, a2;
+    };
+
+    struct channel
+    {
+        // filter states
+        double z1[2];
+        double z2[2];
+
+        float input[HISTORY + BLOCK];
+    };
+
+private:
+    bool m_enabled;
+    unsigned int m_channels;
+
+    biquad m_shelf;
+    biquad m_highpass;
+
+    float m_taps[OVERSAMPLING][PHASE_TAPS];
+
+    /// Highest gain of the interpolator, bounds the true peak of a block
+    float m_tapsGain;
+
+    channel m_state[MAX_CHANNELS];
+
+    uint_least32_t m_stepLength;
+    uint_least32_t m_stepFrames;
+    double m_stepPower;
+
+    /// Power of the last 30 steps
+    std::vector<double> m_steps;
+    unsigned int m_stepCount;
+
+    /// Power of the gating blocks and short-term windows
+    std::vector<double> m_blocks;
+    std::vector<double> m_shortTerm;
+
+    float m_peak;
+    float m_truePeak;
+
+private:
+    template <unsigned int CHANNELS>
+    void weight(unsigned int frames);
+    void truePeak(const float *input, unsigned int frames);
+    void processBlock(unsigned int frames);
+    void endStep();
+
+public:
+    loudnessMeter() : m_enabled(false), m_channels(0) {}
+
+    /**
+     * Start a new measurement.
+     *
+     * @param frequency the sampling frequency
+     * @param channels number of channels, disabled if unsupported
+     */
+    void reset(uint_least32_t frequency, unsigned int channels);
+
+    /**
+     * Make room for the history of a song of known length,
+     * so that measuring it doesn't allocate.
+     *
+     * @param ms the length in milliseconds
+     */
+    void reserve(uint_least32_t ms);
+
+    /// Stop measuring.
+    void disable() { m_enabled = false; }
+
+    bool enabled() const { return m_enabled; }
+
+    /**
+     * Feed the mixed output.
+     *
+     * @param buffer interleaved samples
+     * @param frames number of frames
+     */
+    void samples(const short *buffer, uint_least32_t frames);
+
+    /// Gated integrated loudness in LUFS, -inf if too quiet
+    double integrated() const;
+
+    /// Loudness range in LU
+    double range() const;
+
+    /// Highest sample value, 1.0 is full scale
+    double samplePeak() const { return m_peak; }
+
+    /// Highest interpolated sample value, 1.0 is full scale
+    double truePeak() const { return m_truePeak; }
+};
+
+#endif // LOUDNESS_H
@@ -117,6 +117,7 @@ void sighandler (int signum)
     case SIGTERM:
         // Exit now!
         g_player->stop ();
+        keyboard_wakeup ();
         break;
     default: break;
     }
@@ -22,37 +22,142 @@
 
 #include "mixer.h"
 
+#include <algorithm>
 #include <cassert>
-#include <cstring>
+#include <cmath>
+#include <iterator>
+
+Mixer::decimator::decimator(unsigned int maxStages) :
+    m_stages(maxStages),
+    m_output(BLOCK / 2 + 1)
+{
+    unsigned int length = BLOCK;
+    for (stage &s: m_stages)
+    {
+        s.buffer.resize(HISTORY + 1 + length);
+        length = length / 2 + 1;
+    }
+}
+
+void Mixer::decimator::reset(unsigned int stages)
+{
+    assert(stages <= m_stages.size());
+    m_active = stages;
+    for (stage &s: m_stages)
+    {
+        std::fill(s.buffer.begin(), s.buffer.begin() + HISTORY, 0);
+        s.length = HISTORY;
+    }
+}
+
+unsigned int Mixer::decimator::run(stage &s, int_least32_t* out)
+{
+    const int_least32_t* in = s.buffer.data();
+    const unsigned int length = (s.length - HISTORY) / 2;
+
+    for (unsigned int i = 0; i < length; i++)
+    {
+        const int_least32_t* x = in + i * 2;
+        const int_least32_t sample =
+              3 * (x[0] + x[10])
+            - 25 * (x[2] + x[8])
+            + 150 * (x[4] + x[6])
+            + 256 * x[5];
+        out[i] = (sample + 256) >> 9;
+    }
+
+    // keep the history and the odd sample, if any
+    const unsigned int consumed = length * 2;
+    s.length -= consumed;
+    std::copy(s.buffer.begin() + consumed, s.buffer.begin() + consumed + s.length, s.buffer.begin());
+    return length;
+}
+
+unsigned int Mixer::decimator::process(const short* in, unsigned int length, short* out)
+{
+    assert(length <= BLOCK);
+
+    stage &first = m_stages[0];
+    std::copy(in, in + length, first.buffer.begin() + first.length);
+    first.length += length;
+
+    for (unsigned int i = 0; i < m_active - 1; i++)
+    {
+        stage &next = m_stages[i + 1];
+        next.length += run(m_stages[i], next.buffer.data() + next.length);
+    }
+
+    length = run(m_stages[m_active - 1], m_output.data());
+    for (unsigned int i = 0; i < length; i++)
+    {
+        out[i] = clip(m_output[i]);
+    }
+    return length;
+}
+
+unsigned int Mixer::decimator::pending() const
+{
+    unsigned int samples = 0;
+    for (unsigned int i = 0; i < m_active; i++)
+    {
+        samples += (m_stages[i].length - HISTORY) << i;
+    }
+    return samples;
+}
 
 Mixer::Mixer() :
+    m_decimators(MAX_CHIPS, decimator(MAX_STAGES)),
+    m_ffBuffer(MAX_CHIPS * decimator::BLOCK),
     m_rand(257254)
 {
+    std::fill(std::begin(m_panning), std::end(m_panning), -1.);
     setVolume(VOLUME_MAX);
 }
 
 void Mixer::initialize(unsigned int chips, bool stereo)
 {
-    assert((chips >= 1) && (chips <= 3));
+    assert((chips >= 1) && (chips <= MAX_CHIPS));
     m_channels = stereo ? 2 : 1;
-    m_mix.resize(m_channels);
     m_chips = chips;
-    m_iSamples.resize(chips);
+    m_remaining = 0;
+
+    // Normalize the output to avoid clipping when all the chips are playing
+    const double scale = SCALE_FACTOR / std::sqrt(static_cast<double>(chips));
+
+    for (unsigned int k = 0; k < chips; k++)
+    {
+        if (stereo)
+        {
+            double pan = m_panning[k];
+            if (pan < 0.)
+            {
+                // Spread the chips evenly, leaving the center to the single chip
+                pan = (chips == 1) ? 0.5 : 0.25 + 0.5 * k / (chips - 1);
+            }
+
+            const double left = std::min(1., 2. * (1. - pan));
+            const double right = std::min(1., 2. * pan);
+            m_coeff[0][k] = static_cast<int_least32_t>(left * scale);
+            m_coeff[1][k] = static_cast<int_least32_t>(right * scale);
+        }
+        else
+        {
+            m_coeff[0][k] = static_cast<int_least32_t>(scale);
+        }
+    }
+
     switch (chips)
     {
     case 1:
-        m_mix[0] = stereo ? &Mixer::stereo_OneChip : &Mixer::template mono<1>;
-        if (stereo) m_mix[1] = &Mixer::stereo_OneChip;
+        m_kernel = stereo ? &Mixer::matrix<1, 2> : &Mixer::matrix<1, 1>;
         break;
     case 2:
-        m_mix[0] = stereo ? &Mixer::stereo_ch1_TwoChips : &Mixer::template mono<2>;
-        if (stereo) m_mix[1] = &Mixer::stereo_ch2_TwoChips;
+        m_kernel = stereo ? &Mixer::matrix<2, 2> : &Mixer::matrix<2, 1>;
         break;
     case 3:
-        m_mix[0] = stereo ? &Mixer::stereo_ch1_ThreeChips : &Mixer::template mono<3>;
-        if (stereo) m_mix[1] = &Mixer::stereo_ch2_ThreeChips;
+        m_kernel = stereo ? &Mixer::matrix<3, 2> : &Mixer::matrix<3, 1>;
         break;
-     }
+    }
 }
 
 void Mixer::begin(short *buffer, uint_least32_t length)
@@ -60,84 +165,118 @@ void Mixer::begin(short *buffer, uint_least32_t length)
     m_dest = buffer;
     m_dest_size = length;
 
-    m_pos = m_buffer.size();
-    if (m_pos) LIKELY
-        std::memcpy(m_dest, m_buffer.data(), m_pos*sizeof(short));
+    m_pos = 0;
+    if (m_remaining) LIKELY
+        mixRemaining();
+}
+
+void Mixer::scale(short* dest, uint_least32_t samples)
+{
+    for (uint_least32_t i=0; i<samples; i++)
+    {
+        dest[i] = static_cast<short>((dest[i] * m_volume + triangularDithering()) / VOLUME_MAX);
+    }
 }
 
 uint_least32_t Mixer::mix(short** buffers, uint_least32_t start, uint_least32_t length, short* dest)
 {
-    uint_least32_t j = 0;
-    for (uint_least32_t i=0; i<length;)
+    const short* src[MAX_CHIPS];
+    uint_least32_t frames;
+
+    if (m_fastForwardFactor == 1) LIKELY
     {
-        if (m_fastForwardFactor == 1) LIKELY
+        for (unsigned int c=0; c<m_chips; c++)
         {
-            for (unsigned int c=0; c<m_chips; c++)
-            {
-                m_iSamples[c] = buffers[c][start+i];
-            }
-
-            i++;
+            src[c] = buffers[c] + start;
         }
-        else
+
+        frames = length;
+        (this->*m_kernel)(src, frames, dest);
+    }
+    else
+    {
+        frames = 0;
+        for (uint_least32_t i=0; i<length; i+=decimator::BLOCK)
         {
+            const unsigned int block = std::min(length - i, static_cast<uint_least32_t>(decimator::BLOCK));
+            unsigned int res = 0;
             for (unsigned int c=0; c<m_chips; c++)
             {
-                // Apply boxcar filter
-                int_least32_t sample = 0;
-                const short *buffer = &buffers[c][start+i];
-                for (unsigned int k = 0; k < m_fastForwardFactor; k++)
-                {
-                    sample += buffer[k];
-                }
-
-                m_iSamples[c] = sample / m_fastForwardFactor;
+                short *ffBuffer = &m_ffBuffer[c * decimator::BLOCK];
+                res = m_decimators[c].process(buffers[c] + start + i, block, ffBuffer);
+                src[c] = ffBuffer;
             }
 
-            // increment i to mark we ate some samples.
-            i += m_fastForwardFactor;
+            (this->*m_kernel)(src, res, dest + frames * m_channels);
+            frames += res;
         }
+    }
 
-        for (unsigned int c=0; c<m_channels; c++)
-        {
-            const int_least32_t tmp = (this->*(m_scale))(c);
-            assert(tmp >= -32768 && tmp <= 32767);
-            dest[j++] = static_cast<short>(tmp);
-        }
+    const uint_least32_t samples = frames * m_channels;
+    if (m_volume != VOLUME_MAX) UNLIKELY
+        scale(dest, samples);
+
+    return samples;
+}
+
+void Mixer::mixRemaining()
+{
+    // Number of input samples needed to fill the destination
+    uint_least32_t space = (m_dest_size - m_pos) / m_channels;
+    if (m_fastForwardFactor != 1)
+    {
+        if (space == 0) UNLIKELY
+            return;
+        space = space * m_fastForwardFactor - m_decimators[0].pending();
     }
-    return j;
+
+    uint_least32_t const cnt = std::min(m_remaining, space);
+    m_pos += mix(m_buffers, m_offset, cnt, m_dest + m_pos);
+    m_offset += cnt;
+    m_remaining -= cnt;
 }
 
 void Mixer::doMix(short** buffers, uint_least32_t samples)
 {
-    uint_least32_t const cnt = std::min(samples, (m_dest_size-m_pos)/m_channels);
-    uint_least32_t const res = mix(buffers, 0, cnt, m_dest+m_pos);
-    m_pos += res;
+    assert(m_remaining == 0);
 
-    // save remaining samples, if any
-    uint_least32_t const rem = samples - cnt;
-    if (rem)
+    for (unsigned int c=0; c<m_chips; c++)
     {
-        m_buffer.resize(static_cast<std::size_t>(rem)*m_channels);
-        mix(buffers, cnt, rem, m_buffer.data());
+        m_buffers[c] = buffers[c];
     }
-    else
-        m_buffer.clear();
+
+    m_offset = 0;
+    m_remaining = samples;
+    mixRemaining();
 }
 
 void Mixer::setVolume(unsigned int vol)
 {
     assert(vol <= VOLUME_MAX);
     m_volume = vol;
-
-    m_scale = (vol == VOLUME_MAX) ? &Mixer::noScale : &Mixer::scale;
 }
 
 bool Mixer::setFastForward(unsigned int ff)
 {
-    if (ff < 1 || ff > 32)
+    if (ff < 1 || ff > MAX_FAST_FORWARD || (ff & (ff - 1)))
         return false;
 
+    unsigned int stages = 0;
+    while ((1u << stages) < ff)
+        stages++;
+
+    for (decimator &d: m_decimators)
+        d.reset(stages);
+
     m_fastForwardFactor = ff;
     return true;
 }
+
+bool Mixer::setPanning(unsigned int chip, double pan)
+{
+    if (chip >= MAX_CHIPS || pan > 1.)
+        return false;
+
+    m_panning[chip] = pan;
+    return true;
+}
@@ -26,15 +26,11 @@
 
 #include <stdint.h>
 
-#include <numeric>
+#include <algorithm>
 #include <vector>
 
 #include "sidcxx11.h"
 
-#if defined(HAVE_CXX20) && defined(__cpp_lib_math_constants)
-#  include <numbers>
-#endif
-
 /**
  * This class implements the mixer.
  */
@@ -62,32 +58,79 @@ private:
         }
     };
 
-private:
-    static constexpr int_least32_t SCALE_FACTOR = 1 << 16;
-
-#if defined(HAVE_CXX20) && defined(__cpp_lib_math_constants)
-    static constexpr double SQRT_2 = std::numbers::sqrt2;
-    static constexpr double SQRT_3 = std::numbers::sqrt3;
-#else
-    static constexpr double SQRT_2 = 1.41421356237;
-    static constexpr double SQRT_3 = 1.73205080757;
-#endif
-
-    static constexpr int_least32_t SCALE[3] = {
-        SCALE_FACTOR,                                               // 1 chip, no scale
-        static_cast<int_least32_t>((1.0 / SQRT_2) * SCALE_FACTOR),  // 2 chips, scale by sqrt(2)
-        static_cast<int_least32_t>((1.0 / SQRT_3) * SCALE_FACTOR)   // 3 chips, scale by sqrt(3)
+    /*
+     * Decimate by powers of two using a cascade of half-band filters.
+     *
+     * Each stage uses the 11 taps filter
+     * (3, 0, -25, 0, 150, 256, 150, 0, -25, 0, 3) / 512
+     * and only computes the even output samples.
+     */
+    class decimator
+    {
+    public:
+        /// Max number of input samples per call
+        static constexpr unsigned int BLOCK = 256;
+
+    private:
+        static constexpr unsigned int HISTORY = 10;
+
+        struct stage
+        {
+            std::vector<int_least32_t> buffer;
+            unsigned int length;
+        };
+
+    private:
+        std::vector<stage> m_stages;
+        std::vector<int_least32_t> m_output;
+        unsigned int m_active = 0;
+
+    private:
+        static unsigned int run(stage &s, int_least32_t* out);
+
+    public:
+        explicit decimator(unsigned int maxStages);
+
+        /**
+         * Set the number of stages and clear the filter history.
+         */
+        void reset(unsigned int stages);
+
+        /**
+         * Decimate a block of samples.
+         *
+         * @param in the input samples
+         * @param length number of input samples, at most #BLOCK
+         * @param out the output buffer
+         * @return the number of output samples
+         */
+        unsigned int process(const short* in, unsigned int length, short* out);
+
+        /**
+         * Number of input samples already consumed
+         * which are still waiting to produce an output sample.
+         */
+        unsigned int pending() const;
     };
 
 private:
-    using mixer_func_t = int_least32_t (Mixer::*)() const;
+    static constexpr int_least32_t SCALE_FACTOR = 1 << 15;
+
+    static constexpr unsigned int MAX_STAGES = 7;
 
-    using scale_func_t = int (Mixer::*)(unsigned int);
+    static constexpr unsigned int MAX_CHIPS = 3;
+    static constexpr unsigned int MAX_CHANNELS = 2;
+
+private:
+    using kernel_func_t = void (Mixer::*)(const short* const*, uint_least32_t, short*) const;
 
 public:
     /// Maximum allowed volume, must be a power of 2.
     static constexpr unsigned int VOLUME_MAX = 1024;
 
+    /// Maximum fast forward ratio.
+    static constexpr unsigned int MAX_FAST_FORWARD = 1 << MAX_STAGES;
+
 private:
     uint_least32_t m_pos = 0;
     uint_least32_t m_dest_size = 0;
@@ -100,11 +143,27 @@ private:
     unsigned int m_fastForwardFactor = 1;
 
     int_least32_t m_volume;
-    scale_func_t m_scale;
 
-    std::vector<int_least32_t> m_iSamples;
-    std::vector<short> m_buffer;
-    std::vector<mixer_func_t> m_mix;
+    /// Stereo position of each chip, negative for default
+    double m_panning[MAX_CHIPS];
+
+    /// Fixed point channel matrix, computed at initialization
+    int_least32_t m_coeff[MAX_CHANNELS][MAX_CHIPS];
+
+    kernel_func_t m_kernel;
+
+    std::vector<decimator> m_decimators;
+    std::vector<short> m_ffBuffer;
+
+    /*
+     * Samples that didn't fit in the destination buffer
+     * are left in the emulation buffers, which stay valid
+     * until the next call to the engine, and mixed
+     * at the next #begin call.
+     */
+    short* m_buffers[MAX_CHIPS];
+    uint_least32_t m_offset = 0;
+    uint_least32_t m_remaining = 0;
 
     randomLCG<VOLUME_MAX> m_rand;
 
@@ -116,19 +175,13 @@ private:
         return static_cast<int_least32_t>(m_oldRandomValue - prevValue);
     }
 
-    int scale(unsigned int ch)
+    static short clip(int_least32_t sample)
     {
-        const int_least32_t sample = (this->*(m_mix[ch]))();
-        return (sample * m_volume + triangularDithering()) / VOLUME_MAX;
-    }
-
-    int noScale(unsigned int ch)
-    {
-        return (this->*(m_mix[ch]))();
+        return static_cast<short>(std::min<int_least32_t>(std::max<int_least32_t>(sample, -32768), 32767));
     }
 
     /*
-     * Channel matrix
+     * Default channel matrix
      *
      *   C1
      * L 1.0
@@ -141,52 +194,67 @@ private:
      *   C1    C2    C3
      * L 1.0   1.0   0.5
      * R 0.5   1.0   1.0
+     *
+     * The chips are positioned using a balance law,
+     * the center being full volume on both channels.
+     * In mono mode all the chips are summed.
      */
-
-    // Mono mixing
-    template <unsigned int Chips>
-    int_least32_t mono() const
+    template <unsigned int Chips, unsigned int Channels>
+    void matrix(const short* const* src, uint_least32_t frames, short* dest) const
     {
-        static_assert((Chips >= 1) && (Chips <= 3), "Unsupported number of chips");
-        int_least32_t res = std::accumulate(m_iSamples.begin(), m_iSamples.end(), 0);
-        return res * SCALE[Chips-1] / SCALE_FACTOR;
-    }
-
-    // Stereo mixing
-    int_least32_t stereo_OneChip() const { return m_iSamples[0]; }
+        static_assert((Chips >= 1) && (Chips <= MAX_CHIPS), "Unsupported number of chips");
+        static_assert((Channels >= 1) && (Channels <= MAX_CHANNELS), "Unsupported number of channels");
+
+        // Keep everything in locals so the compiler
+        // can vectorize the loop
+        const short* in[Chips];
+        int_least32_t coeff[Channels][Chips];
+        for (unsigned int k = 0; k < Chips; k++)
+        {
+            in[k] = src[k];
+            for (unsigned int c = 0; c < Channels; c++)
+                coeff[c][k] = m_coeff[c][k];
+        }
 
-    int_least32_t stereo_ch1_TwoChips() const
-    {
-        return (m_iSamples[0] + 0.5*m_iSamples[1]) * SCALE[1] / SCALE_FACTOR;
-    }
-    int_least32_t stereo_ch2_TwoChips() const
-    {
-        return (0.5*m_iSamples[0] + m_iSamples[1]) * SCALE[1] / SCALE_FACTOR;
+        for (uint_least32_t i = 0; i < frames; i++)
+        {
+            for (unsigned int c = 0; c < Channels; c++)
+            {
+                int_least32_t sample = 0;
+                for (unsigned int k = 0; k < Chips; k++)
+                    sample += in[k][i] * coeff[c][k];
+                dest[i * Channels + c] = clip(sample / SCALE_FACTOR);
+            }
+        }
     }
 
-    int_least32_t stereo_ch1_ThreeChips() const
-    {
-        return (m_iSamples[0] + m_iSamples[1] + 0.5*m_iSamples[2]) * SCALE[2] / SCALE_FACTOR;
-    }
-    int_least32_t stereo_ch2_ThreeChips() const
-    {
-        return (0.5*m_iSamples[0] + m_iSamples[1] + m_iSamples[2]) * SCALE[2] / SCALE_FACTOR;
-    }
+    void scale(short* dest, uint_least32_t samples);
 
     inline uint_least32_t mix(short** buffers, uint_least32_t start, uint_least32_t length, short* dest);
 
+    void mixRemaining();
+
 public:
     Mixer();
 
     void initialize(unsigned int chips, bool stereo);
 
+    /**
+     * Start filling a new buffer, the samples left from
+     * the previous call are mixed first so the buffer
+     * may already be full on return.
+     */
     void begin(short *buffer, uint_least32_t length);
 
+    /**
+     * Mix the samples produced by the engine.
+     * Must not be called when the buffer is full.
+     */
     void doMix(short** buffers, uint_least32_t samples);
 
     bool isFull() const { return m_pos >= m_dest_size; }
 
-    void clear() { m_buffer.resize(0); }
+    void clear() { m_remaining = 0; }
 
     /**
      * Set mixing volumes.
@@ -198,10 +266,22 @@ public:
     /**
      * Set the fast forward ratio.
      *
-     * @param ff the fast forward ratio, from 1 to 32
+     * @param ff the fast forward ratio, a power of two
+     *        from 1 to #MAX_FAST_FORWARD
      * @return true if parameter is valid, false otherwise
      */
     bool setFastForward(unsigned int ff);
+
+    /**
+     * Set the stereo position of a chip.
+     * Takes effect at the next #initialize call.
+     *
+     * @param chip the chip number, from 0 to 2
+     * @param pan the position, from 0.0 (left) to 1.0 (right),
+     *        a negative value restores the default
+     * @return true if parameters are valid, false otherwise
+     */
+    bool setPanning(unsigned int chip, double pan);
 };
 
 #endif // MIXER_H
@@ -21,8 +21,6 @@
 
 #include "player.h"
 
-#include "filesystem/filesystem.hpp"
-
 #include <fmt/format.h>
 
 #include <cstdlib>
@@ -34,12 +32,16 @@
 #include <memory>
 #include <new>
 #include <chrono>
-#include <thread>
 
 #include "utils.h"
+#include "allocCheck.h"
 #include "keyboard.h"
+#include "realtime.h"
+#include "romLoader.h"
 #include "audio/AudioDrv.h"
 #include "audio/au/auFile.h"
+#include "audio/flac/flacFile.h"
+#include "audio/raw/rawFile.h"
 #include "audio/wav/WavFile.h"
 
 #include "sidcxx11.h"
@@ -66,6 +68,32 @@ constexpr uint_least32_t SID2_PREV_SONG_TIMEOUT = 4000;
 constexpr uint_least32_t FREQ_PAL = 50;
 constexpr uint_least32_t FREQ_NTSC = 60;
 
+#ifdef FEAT_NEW_PLAY_API
+// Cycles to run at once when output is discarded
+constexpr unsigned int DISCARD_CYCLES = MAX_CYCLES;
+
+// Cycles per video frame
+constexpr unsigned int FRAME_CYCLES_PAL = 63 * 312;
+constexpr unsigned int FRAME_CYCLES_NTSC = 65 * 263;
+
+// Extra time to look for a loop past twice the song length
+constexpr uint_least32_t LOOP_SEARCH_MARGIN = 10000;
+#endif
+
+// ReplayGain 2.0 reference level in LUFS
+constexpr double REPLAYGAIN_REFERENCE = -18.;
+
+// Playback time in milliseconds measured before falling back
+// to a cheaper emulation
+constexpr uint_least32_t SPEED_CHECK_TIME = 3000;
+
+// Lowest acceptable real time factor, leaves headroom for
+// the output and the rest of the system
+constexpr double SPEED_CHECK_MARGIN = 1.25;
+
+// Change when the rendered output for the same settings changes
+constexpr uint_least32_t RENDER_CACHE_VERSION = 1;
+
 
 const char* ERR_NOT_ENOUGH_MEMORY = "ERROR: Not enough memory.";
 const char* ERR_NO_SID_EMULATION  = "ERROR: Requested SID emulation not built in.";
@@ -251,8 +279,6 @@ static const filter_map_t filterCurveMap =
 };
 #endif
 
-namespace fs = ghc::filesystem;
-
 #ifdef FEAT_FILTER_RANGE
 double getRecommendedFilterRange(const std::string& author)
 {
@@ -272,75 +298,8 @@ double getRecommendedFilterCurve(const std::string& author)
 }
 #endif
 
-std::unique_ptr<uint8_t[]> loadRom(const std::string &romPath, const int size)
-{
-    fs::ifstream is(romPath, std::ios::binary);
-
-    if (is.is_open())
-    {
-        try
-        {
-            std::unique_ptr<uint8_t[]> buffer(new uint8_t[size]);
-
-            is.read((char*)buffer.get(), size);
-            if (!is.fail())
-            {
-                is.close();
-                return buffer;
-            }
-        }
-        catch (std::bad_alloc const &ba) {}
-    }
-
-    return nullptr;
-}
-
-
-std::unique_ptr<uint8_t[]> loadRom(const std::string &romPath, const int size, const char* defaultRom)
-{
-    // Try to load given rom
-    if (!romPath.empty())
-    {
-        std::unique_ptr<uint8_t[]> buffer = loadRom(romPath, size);
-        if (buffer)
-            return buffer;
-    }
-
-    // Fallback to default rom path
-    try
-    {
-#ifdef _WIN32
-        {
-            // Try exec dir first
-            std::string execPath(utils::getExecPath());
-            execPath.append(SEPARATOR).append(defaultRom);
-            std::unique_ptr<uint8_t[]> buffer = loadRom(execPath, size);
-            if (buffer)
-                return buffer;
-        }
-#endif
-        std::string dataPath(utils::getDataPath());
-
-        dataPath.append(SEPARATOR).append("sidplayfp").append(SEPARATOR).append(defaultRom);
-
-#if !defined _WIN32 && defined HAVE_UNISTD_H
-        if (::access(dataPath.c_str(), R_OK) != 0)
-        {
-            dataPath = PKGDATADIR;
-            dataPath.append(defaultRom);
-        }
-#endif
-
-        return loadRom(dataPath, size);
-    }
-    catch (utils::error const &e)
-    {
-        return nullptr;
-    }
-}
-
-
 ConsolePlayer::ConsolePlayer (const char * const name) :
+    m_startupProfile(false),
     m_name(name),
     m_tune(nullptr),
     m_state(playerStopped),
@@ -352,8 +311,20 @@ ConsolePlayer::ConsolePlayer (const char * const name) :
     m_cpudebug(false),
     m_autofilter(false),
     m_console_inited(false),
-    no_color(false)
+    no_color(false),
+    m_singleLoop(false),
+    m_measureLoudness(false),
+    m_romsLoaded(false),
+    m_basicLoaded(false),
+    m_realtimeDone(false),
+    m_allocCheck(false),
+    m_steadyState(false),
+    m_measureSpeed(false),
+    m_measuredFrames(0),
+    m_emulationTime(0)
 {
+    m_profile.mark("engine");
+
     if (std::getenv("NO_COLOR"))
         no_color = true;
 
@@ -373,7 +344,11 @@ ConsolePlayer::ConsolePlayer (const char * const name) :
     m_track.loop     = false;
     m_track.single   = false;
     m_speed.current  = 1;
+#ifdef FEAT_NEW_PLAY_API
+    m_speed.max      = Mixer::MAX_FAST_FORWARD;
+#else
     m_speed.max      = 32;
+#endif
 
     // Read default configuration
     m_iniCfg.read ();
@@ -400,6 +375,12 @@ ConsolePlayer::ConsolePlayer (const char * const name) :
         m_channels            = audio.channels;
         m_precision           = audio.precision;
         m_buffer_size         = audio.getBufSize();
+        m_queue_depth         = audio.queueDepth;
+#ifdef FEAT_NEW_PLAY_API
+        m_panning[0]          = audio.panning[0];
+        m_panning[1]          = audio.panning[1];
+        m_panning[2]          = audio.panning[2];
+#endif
         m_filter.enabled      = emulation.filter;
         m_filter.bias         = emulation.bias;
         m_filter.filterCurve6581 = emulation.filterCurve6581;
@@ -475,11 +456,33 @@ ConsolePlayer::ConsolePlayer (const char * const name) :
 #endif
     createOutput (output_t::NONE, nullptr);
     createSidEmu (EMU_NONE, nullptr);
+    m_profile.mark("config file");
+}
 
-    std::unique_ptr<uint8_t[]> kernalRom = loadRom((m_iniCfg.sidplay2()).kernalRom, 8192, "kernal");
-    std::unique_ptr<uint8_t[]> basicRom = loadRom((m_iniCfg.sidplay2()).basicRom, 8192, "basic");
-    std::unique_ptr<uint8_t[]> chargenRom = loadRom((m_iniCfg.sidplay2()).chargenRom, 4096, "chargen");
-    m_engine.setRoms(kernalRom.get(), basicRom.get(), chargenRom.get());
+// The engine copies the images and replaces all three
+// on each call, a null pointer clears the BASIC and character
+// ROMs and installs a minimal kernal. The images loaded so far
+// are passed again when BASIC is added.
+void ConsolePlayer::loadRoms(const SidTuneInfo *tuneInfo)
+{
+    // Only BASIC programs need the interpreter
+    const bool needBasic = !m_basicLoaded
+        && (tuneInfo->compatibility() == SidTuneInfo::COMPATIBILITY_BASIC);
+    if (m_romsLoaded && !needBasic)
+        return;
+
+    // The images are kept by the loader, so asking
+    // again for those already loaded is cheap
+    std::shared_ptr<const romImage> kernalRom = loadRom((m_iniCfg.sidplay2()).kernalRom, 8192, "kernal");
+    std::shared_ptr<const romImage> basicRom = needBasic
+        ? loadRom((m_iniCfg.sidplay2()).basicRom, 8192, "basic") : nullptr;
+    std::shared_ptr<const romImage> chargenRom = loadRom((m_iniCfg.sidplay2()).chargenRom, 4096, "chargen");
+    m_engine.setRoms(kernalRom ? kernalRom->data() : nullptr,
+                     basicRom ? basicRom->data() : nullptr,
+                     chargenRom ? chargenRom->data() : nullptr);
+    m_romsLoaded = true;
+    if (needBasic)
+        m_basicLoaded = true;
 }
 
 std::string ConsolePlayer::getFileName(const SidTuneInfo *tuneInfo, const char* ext) const
@@ -518,6 +521,7 @@ bool ConsolePlayer::createOutput (output_t driver, const SidTuneInfo *tuneInfo)
     // Remove old audio driver
     m_driver.null.close ();
     m_driver.selected = &m_driver.null;
+    m_driver.discard  = true;
     if (m_driver.device != nullptr)
     {
         if (m_driver.device != &m_driver.null)
@@ -547,7 +551,7 @@ bool ConsolePlayer::createOutput (output_t driver, const SidTuneInfo *tuneInfo)
         try
         {
             std::string title = getFileName(tuneInfo, WavFile::extension());
-            WavFile* wav = new WavFile(title);
+            WavFile* wav = new WavFile(title, m_queue_depth);
             if (m_driver.info && (tuneInfo->numberOfInfoStrings() == 3))
                 wav->setInfo(tuneInfo->infoString(0), tuneInfo->infoString(1), tuneInfo->infoString(2));
             m_driver.device = wav;
@@ -562,7 +566,34 @@ bool ConsolePlayer::createOutput (output_t driver, const SidTuneInfo *tuneInfo)
         try
         {
             std::string title = getFileName(tuneInfo, auFile::extension());
-            m_driver.device = new auFile(title);
+            m_driver.device = new auFile(title, m_queue_depth);
+        }
+        catch (std::bad_alloc const &ba)
+        {
+            m_driver.device = nullptr;
+        }
+    break;
+
+    case output_t::FLAC:
+        try
+        {
+            std::string title = getFileName(tuneInfo, flacFile::extension());
+            flacFile* flac = new flacFile(title);
+            if (m_driver.info && (tuneInfo->numberOfInfoStrings() == 3))
+                flac->setInfo(tuneInfo->infoString(0), tuneInfo->infoString(1), tuneInfo->infoString(2));
+            m_driver.device = flac;
+        }
+        catch (std::bad_alloc const &ba)
+        {
+            m_driver.device = nullptr;
+        }
+    break;
+
+    case output_t::RAW:
+        try
+        {
+            std::string title = getFileName(tuneInfo, rawFile::extension());
+            m_driver.device = new rawFile(title, m_queue_depth);
         }
         catch (std::bad_alloc const &ba)
         {
@@ -899,11 +930,14 @@ bool ConsolePlayer::open()
 
     // Select the required song
     m_track.selected = m_tune.selectSong(m_track.selected);
+    loadRoms(m_tune.getInfo());
+    m_profile.mark("roms");
     if (!m_engine.load (&m_tune))
     {
         displayError (m_engine.error());
         return false;
     }
+    m_profile.mark("tune setup");
 
     // Get tune details
     const SidTuneInfo *tuneInfo = m_tune.getInfo();
@@ -911,6 +945,7 @@ bool ConsolePlayer::open()
         m_track.songs = tuneInfo->songs();
     if (!createOutput(m_driver.output, tuneInfo))
         return false;
+    m_profile.mark("audio output");
     if (!createSidEmu(m_driver.sid, tuneInfo))
         return false;
 
@@ -920,6 +955,7 @@ bool ConsolePlayer::open()
         displayError(m_engine.error ());
         return false;
     }
+    m_profile.mark("emulation");
 
 #ifdef FEAT_FILTER_DISABLE
     for (int chip=0; chip<3; chip++)
@@ -940,12 +976,36 @@ bool ConsolePlayer::open()
         m_freqTable = freqTablePal;
 #endif
 #ifdef FEAT_NEW_PLAY_API
+    for (unsigned int chip=0; chip<3; chip++)
+    {
+        if (!m_mixer.setPanning(chip, m_panning[chip]))
+        {
+            displayError ("ERROR: Invalid panning value");
+            return false;
+        }
+    }
     m_mixer.initialize(m_engine.installedSIDs(), m_driver.cfg.channels == 2);
+
+    {
+        // Throughput matters more than latency when recording
+        const int cycles = m_chunk.has_value()
+            ? m_chunk.value()
+            : m_driver.file
+                ? (m_iniCfg.emulation()).recordChunk
+                : (m_iniCfg.emulation()).playChunk;
+        m_cycles = std::min(std::max(cycles, MIN_CYCLES), MAX_CYCLES);
+    }
+#  ifdef FEAT_REGS_DUMP_SID
+    // Look at the registers once per frame
+    if (m_singleLoop)
+        m_cycles = (m_freqTable == freqTableNtsc) ? FRAME_CYCLES_NTSC : FRAME_CYCLES_PAL;
+#  endif
 #endif
 
     // Start the player.  Do this by fast
     // forwarding to the start position
     m_driver.selected = &m_driver.null;
+    m_driver.discard  = true;
     m_speed.current   = m_speed.max;
 #ifdef FEAT_NEW_PLAY_API
     m_mixer.clear();
@@ -968,6 +1028,7 @@ bool ConsolePlayer::open()
 
     // As yet we don't have a required songlength
     // so try the songlength database or keep the default
+    bool lengthKnown = m_timer.valid;
     if (!m_timer.valid)
     {
         int_least32_t length = songlengthDB == sldb_t::MD5
@@ -990,13 +1051,40 @@ bool ConsolePlayer::open()
                     : FREQ_PAL;
             }
             m_timer.length = length;
+            lengthKnown = true;
         }
     }
 
+    // Look for the end if we're just guessing the length
+    const uint_least32_t endDetectTime = lengthKnown ? 0
+        : m_endDetectTime.has_value()
+            ? m_endDetectTime.value()
+            : (m_iniCfg.sidplay2()).endDetectTime;
+    m_endDetector.reset(endDetectTime);
+    m_detectedLength = 0;
+    m_steadyState = false;
+
+#if defined(FEAT_NEW_PLAY_API) && defined(FEAT_REGS_DUMP_SID)
+    m_loopDetector.reset(m_singleLoop);
+#endif
+    m_loopPosition = 0;
+
+    if (m_measureLoudness)
+        m_loudness.reset(m_driver.cfg.frequency, m_driver.cfg.channels);
+    else
+        m_loudness.disable();
+
     // Set up the play timer
     m_timer.stop = m_timer.length;
 #ifdef FEAT_NEW_PLAY_API
-    if (m_fadeAfter)
+    if (m_loopDetector.enabled())
+    {
+        // The database length usually covers the intro and
+        // one loop, the detection needs to see it twice
+        if (!m_timer.valid && m_timer.length)
+            m_timer.stop = 2 * m_timer.length + LOOP_SEARCH_MARGIN;
+    }
+    else if (m_fadeAfter)
         m_timer.stop += m_fadeoutTime;
 #endif
 
@@ -1014,8 +1102,36 @@ bool ConsolePlayer::open()
         }
     }
 
+    // The loudness history grows with the song,
+    // make room for all of it if the length is known
+    if (m_loudness.enabled() && (m_timer.stop > m_timer.start))
+        m_loudness.reserve(m_timer.stop - m_timer.start);
+
     m_timer.current = ~0;
     m_timer.starting = true;
+
+    // A song that can end may have been rendered already,
+    // a single loop needs the loop points which are not stored
+    if (m_cache.enabled() && !m_loopDetector.enabled()
+        && ((m_timer.stop != 0) || m_endDetector.enabled()))
+        openCache(endDetectTime);
+
+    // Reserve space for the whole recording
+    if (m_driver.file && (m_timer.stop > m_timer.start))
+        m_driver.device->setLength(m_timer.stop - m_timer.start);
+
+    if (!m_driver.file)
+        setupRealtime();
+
+    // Only a software emulation playing in real time
+    // can be replaced by a cheaper one
+    const bool autoFallback = m_autoFallback.has_value() ? m_autoFallback.value()
+        : (m_iniCfg.emulation()).autoFallback;
+    m_measureSpeed = autoFallback && !m_driver.file && !m_driver.device->discard()
+        && ((m_driver.sid == EMU_RESIDFP) || (m_driver.sid == EMU_RESID) || (m_driver.sid == EMU_SIDLITE));
+    m_measuredFrames = 0;
+    m_emulationTime = std::chrono::steady_clock::duration::zero();
+
     m_state = playerRunning;
 /*
     if (m_verboseLevel)
@@ -1027,9 +1143,121 @@ bool ConsolePlayer::open()
     // Update display
     menu();
     updateDisplay();
+    m_profile.mark("player setup");
+    m_startTime = std::chrono::steady_clock::now();
     return true;
 }
 
+/*
+ * Keep the thread feeding the audio device from being
+ * preempted or paged out, once everything is allocated.
+ */
+void ConsolePlayer::setupRealtime()
+{
+    if (m_realtimeDone)
+        return;
+    m_realtimeDone = true;
+
+    const IniConfig::audio_section &audio = m_iniCfg.audio();
+    const int priority = m_rtPriority.has_value() ? m_rtPriority.value() : audio.rtPriority;
+    const bool roundRobin = m_rtRoundRobin.has_value() ? m_rtRoundRobin.value() : audio.rtRoundRobin;
+    const int cpu = m_cpuAffinity.has_value() ? m_cpuAffinity.value() : audio.cpuAffinity;
+    const bool lock = m_lockMemory.has_value() ? m_lockMemory.value() : audio.lockMemory;
+
+    auto report = [this](const char *setting, bool ok, const std::string &result)
+    {
+        if (!ok)
+            displayError(fmt::format("WARNING: {}: {}", setting, result).c_str());
+        else if (m_verboseLevel)
+            fmt::print("{}: {}\n", setting, result);
+    };
+
+    std::string result;
+    if (cpu >= 0)
+    {
+        const bool ok = realtime::setAffinity(cpu, result);
+        report("CPU affinity", ok, result);
+    }
+
+    if (lock)
+    {
+        const bool ok = realtime::lockMemory(result);
+        report("Memory lock", ok, result);
+    }
+
+    if (priority > 0)
+    {
+        const bool ok = realtime::setPriority(priority, roundRobin, result);
+        report("Realtime priority", ok, result);
+    }
+
+    if (lock || (priority > 0))
+    {
+        // Fault in the stack and the output buffer now
+        // rather than during playback
+        realtime::prefaultStack();
+        m_driver.device->clearBuffer();
+    }
+}
+
+/*
+ * Compare the time spent filling the buffers with the time
+ * they last. If the emulation can't keep up it is restarted
+ * without resampling or, failing that, with SIDLite.
+ * The choice is kept for the following songs.
+ */
+void ConsolePlayer::checkSpeed(std::chrono::steady_clock::duration elapsed, uint_least32_t frames)
+{
+    m_emulationTime += elapsed;
+    m_measuredFrames += frames;
+    if (m_measuredFrames < (SPEED_CHECK_TIME * m_driver.cfg.frequency) / 1000)
+        return;
+
+    // Measured once per song, reporting allocates
+    m_measureSpeed = false;
+    allocCheck::disarm();
+
+    const std::chrono::duration<double> busy = m_emulationTime;
+    const double factor = (static_cast<double>(m_measuredFrames) / m_driver.cfg.frequency)
+        / std::max(busy.count(), 0.001);
+    if (m_verboseLevel > 1)
+        fmt::print("Emulation speed: {:.2f}x real time\n", factor);
+
+    if (factor >= SPEED_CHECK_MARGIN)
+        return;
+
+    // Don't end up on the time display line
+    if (!m_quietLevel)
+    {
+        fmt::print("\n");
+        std::fflush(stdout);
+    }
+
+    const char *fallback;
+    if (m_engCfg.samplingMethod == SidConfig::RESAMPLE_INTERPOLATE)
+    {
+        m_engCfg.samplingMethod = SidConfig::INTERPOLATE;
+        fallback = "interpolation";
+    }
+#ifdef HAVE_SIDPLAYFP_BUILDERS_SIDLITE_H
+    else if (m_driver.sid != EMU_SIDLITE)
+    {
+        m_driver.sid = EMU_SIDLITE;
+        fallback = "SIDLite";
+    }
+#endif
+    else
+    {
+        displayError(fmt::format("WARNING: Emulation running at {:.2f}x real time, no cheaper emulation available",
+            factor).c_str());
+        return;
+    }
+
+    displayError(fmt::format("WARNING: Emulation running at {:.2f}x real time, restarting with {}",
+        factor, fallback).c_str());
+    m_state = playerFastRestart;
+}
+
 void ConsolePlayer::close()
 {
 #ifndef FEAT_NEW_PLAY_API
@@ -1044,6 +1272,17 @@ void ConsolePlayer::close()
     else // Destroy buffers
         m_driver.selected->reset ();
 
+    // Drop an incomplete render
+    m_cache.close();
+
+    // Stopped before the first buffer, report what was recorded
+    if (!m_profile.finished())
+    {
+        m_profile.finish();
+        if (m_startupProfile)
+            m_profile.print(stderr);
+    }
+
     // Shutdown drivers, etc
     createOutput    (output_t::NONE, nullptr);
     createSidEmu    (EMU_NONE, nullptr);
@@ -1088,12 +1327,20 @@ void ConsolePlayer::emuflush ()
 bool ConsolePlayer::play()
 {
     uint_least32_t frames = 0;
+    allocCheck::scope allocGuard;
     if (m_state == playerRunning) LIKELY
     {
+        // The loop detection keeps a history growing with the song,
+        // as does the loudness measurement if the length is unknown
+        if (m_allocCheck && m_steadyState && !m_loopDetector.enabled()
+            && (!m_loudness.enabled() || (m_timer.stop != 0))) UNLIKELY
+            allocGuard.arm();
+
         updateDisplay();
 #ifdef FEAT_NEW_PLAY_API
         // fadeout
-        const uint_least32_t fadeoutTime = m_fadeoutTime;
+        // A loop must not fade
+        const uint_least32_t fadeoutTime = m_loopDetector.enabled() ? 0 : m_fadeoutTime;
         if (fadeoutTime && (m_timer.stop > fadeoutTime)) UNLIKELY
         {
             const uint_least32_t timeleft = m_timer.stop - m_timer.current;
@@ -1109,58 +1356,138 @@ bool ConsolePlayer::play()
         // getBufSize returns the number of frames
         // multiply by number of channels to get the count of 16bit samples
         const uint_least32_t length = getBufSize() * m_driver.cfg.channels;
-        short *buffer = m_driver.selected->buffer();
+
+        // Fast forward emulates more than the buffer lasts
+        const bool measureSpeed = m_measureSpeed && !m_timer.starting && (m_speed.current == 1);
+        std::chrono::steady_clock::time_point fillStart;
+        if (measureSpeed) UNLIKELY
+            fillStart = std::chrono::steady_clock::now();
+
+        if (m_cache.reading())
+        {
+            // No emulation, just stream the previous render
+            const uint_least32_t requested = length / m_driver.cfg.channels;
+            frames = m_cache.read(m_driver.selected->buffer(), requested);
+            if (frames < requested)
+                m_timer.stop = cachedTimeMs();
+        }
 #ifdef FEAT_NEW_PLAY_API
-        m_mixer.begin(buffer, length);
-        short* buffers[3];
-        m_engine.buffers(buffers);
+        else if (m_driver.discard)
+        {
+            // Nothing to mix, just run the emulation
+            // for the time the buffer would last
+            const uint_least32_t bufferMs = (length / m_driver.cfg.channels) * 1000 / m_driver.cfg.frequency;
+            uint_least32_t target = m_timer.current + bufferMs;
+            if (m_timer.starting && (target > m_timer.start))
+                target = m_timer.start;
+
+            // Loop detection looks at the registers once per frame
+            const bool loop = m_loopDetector.enabled() && !m_timer.starting;
+            const unsigned int cycles = loop ? m_cycles : DISCARD_CYCLES;
+            do
+            {
+                const int samples = m_engine.play(cycles);
+                if (samples < 0) UNLIKELY
+                {
+                    displayError (m_engine.error());
+                    m_state = playerError;
+                    return false;
+                }
+                if (loop) UNLIKELY
+                    checkLoop(samples);
+            }
+            while (m_engine.timeMs() < target);
+        }
+        else
+        {
+            short *buffer = m_driver.selected->buffer();
+            m_mixer.begin(buffer, length);
+            short* buffers[3];
+            m_engine.buffers(buffers);
+
+            // Leftover samples from the previous call may
+            // have already filled the buffer
+            while (!m_mixer.isFull())
+            {
+                int samples = m_engine.play(m_cycles);
+                if (samples < 0) UNLIKELY
+                {
+                    displayError (m_engine.error());
+                    m_state = playerError;
+                    return false;
+                }
+                if (samples > 0)
+                {
+                    m_mixer.doMix(buffers, samples);
+                    if (m_loopDetector.enabled()) UNLIKELY
+                        checkLoop(samples);
+                }
+                else break;
+            }
 
-        do
+            // m_engine.play returns the number of 16bit samples
+            // divide by number of channels to get the count of frames
+            frames = length / m_driver.cfg.channels;
+        }
+#else
+        else
         {
-            int samples = m_engine.play(2000);
-            if (samples < 0) UNLIKELY
+            short *buffer = m_driver.selected->buffer();
+            uint_least32_t samples = m_engine.play(buffer, length);
+            if ((samples < length) || !m_engine.isPlaying()) UNLIKELY
             {
                 displayError (m_engine.error());
                 m_state = playerError;
                 return false;
             }
-            if (!buffer) UNLIKELY
-                break;
-            if (samples > 0)
-                m_mixer.doMix(buffers, samples);
-            else break;
+            // m_engine.play returns the number of 16bit samples
+            // divide by number of channels to get the count of frames
+            frames = samples / m_driver.cfg.channels;
         }
-        while (!m_mixer.isFull());
+#endif
 
-        // m_engine.play returns the number of 16bit samples
-        // divide by number of channels to get the count of frames
-        frames = length / m_driver.cfg.channels;
-#else
-        uint_least32_t samples = m_engine.play(buffer, length);
-        if ((samples < length) || !m_engine.isPlaying()) UNLIKELY
+        if (measureSpeed) UNLIKELY
+            checkSpeed(std::chrono::steady_clock::now() - fillStart, frames);
+
+        if (m_endDetector.enabled() && !m_timer.starting) UNLIKELY
         {
-            displayError (m_engine.error());
-            m_state = playerError;
-            return false;
+            if (!m_driver.discard)
+                m_endDetector.samples(m_driver.selected->buffer(), frames, m_driver.cfg.channels,
+                                        m_timer.current, m_driver.cfg.frequency);
+            checkEnd();
         }
-        // m_engine.play returns the number of 16bit samples
-        // divide by number of channels to get the count of frames
-        frames = samples / m_driver.cfg.channels;
-#endif
+
+        if (m_loudness.enabled() && !m_timer.starting && !m_driver.discard) UNLIKELY
+            m_loudness.samples(m_driver.selected->buffer(), frames);
+
+        if (m_cache.writing() && !m_timer.starting && !m_driver.discard) UNLIKELY
+            m_cache.write(m_driver.selected->buffer(), frames);
     }
-    else
-        // don't choke the processor
-        std::this_thread::sleep_for(std::chrono::microseconds(100000));
+    else if ((m_state == playerPaused) && (m_quietLevel < 2))
+        // Sleep until a key is pressed or a signal arrives
+        keyboard_wait();
 
     switch (m_state)
     {
     LIKELY case playerRunning:
-        if (!m_driver.selected->write(frames)) UNLIKELY
+        if (!m_driver.discard && !m_driver.selected->write(frames)) UNLIKELY
         {
             displayError(m_driver.selected->getErrorString());
             m_state = playerError;
             return false;
         }
+        allocGuard.disarm();
+        if (!m_timer.starting)
+            m_steadyState = true;
+        if (!m_profile.finished() && (m_driver.discard || frames)) UNLIKELY
+        {
+            // Includes fast forwarding to the start time,
+            // without an output the first buffer is emulated only
+            m_profile.mark(m_driver.discard ? "first buffer" : "first sample");
+            m_profile.finish();
+            if (m_startupProfile)
+                m_profile.print(stderr);
+        }
         // fall-through
     case playerPaused:
         // Check for a keypress (approx 250ms rate, but really depends
@@ -1171,7 +1498,46 @@ bool ConsolePlayer::play()
         return true;
     default:
         if (m_quietLevel < 2)
+        {
             fmt::print("\n");
+            if (m_detectedLength)
+            {
+                const uint_least32_t seconds = m_detectedLength / 1000;
+                fmt::print("End detected at {:02}:{:02}.{:03}\n",
+                    seconds / 60, seconds % 60, m_detectedLength % 1000);
+            }
+            if (m_loopDetector.found())
+            {
+                const uint_least64_t frequency = m_driver.cfg.frequency;
+                const uint_least32_t start = m_timer.start + (m_loopDetector.loopStart() * 1000) / frequency;
+                const uint_least32_t end = m_timer.start + (m_loopDetector.loopEnd() * 1000) / frequency;
+                fmt::print("Loop found from {:02}:{:02}.{:03} to {:02}:{:02}.{:03}\n",
+                    start / 60000, (start / 1000) % 60, start % 1000,
+                    end / 60000, (end / 1000) % 60, end % 1000);
+            }
+            else if (m_loopDetector.enabled())
+            {
+                fmt::print("No loop found\n");
+            }
+            if (m_loudness.enabled())
+            {
+                fmt::print("Loudness {:.1f} LUFS, range {:.1f} LU, true peak {:.1f} dBTP\n",
+                    m_loudness.integrated(), m_loudness.range(),
+                    20. * std::log10(m_loudness.truePeak()));
+            }
+        }
+        if (m_loudness.enabled() && std::isfinite(m_loudness.integrated()))
+        {
+            m_driver.device->setReplayGain(REPLAYGAIN_REFERENCE - m_loudness.integrated(),
+                m_loudness.truePeak());
+        }
+        if (m_verboseLevel)
+        {
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - m_startTime;
+            const double emulated = m_timer.current / 1000.;
+            fmt::print("Emulated {:.1f}s in {:.1f}s ({:.1f}x real time)\n",
+                emulated, elapsed.count(), emulated / std::max(elapsed.count(), 0.001));
+        }
 #ifndef FEAT_NEW_PLAY_API
         m_engine.stop ();
 #endif
@@ -1217,6 +1583,7 @@ uint_least32_t ConsolePlayer::getBufSize()
     {   // Switch audio drivers.
         m_timer.starting = false;
         m_driver.selected = m_driver.device;
+        m_driver.discard  = m_driver.selected->discard();
         m_driver.selected->clearBuffer();
 #ifdef FEAT_NEW_PLAY_API
         m_mixer.clear();
@@ -1230,6 +1597,9 @@ uint_least32_t ConsolePlayer::getBufSize()
     }
     else if ((m_timer.stop != 0) && (m_timer.current >= m_timer.stop)) UNLIKELY
     {
+        // The render is complete, storing it allocates
+        allocCheck::disarm();
+        m_cache.commit();
         m_state = playerExit;
         if (m_track.loop)
         {
@@ -1248,7 +1618,7 @@ uint_least32_t ConsolePlayer::getBufSize()
             m_state = playerRestart;
         }
     }
-    else
+    else if (m_timer.stop != 0)
     {
         uint_least32_t remainingMs = m_timer.stop - m_timer.current;
         uint_least32_t bufSize = (remainingMs * m_driver.cfg.frequency) / 1000;
@@ -1260,10 +1630,138 @@ uint_least32_t ConsolePlayer::getBufSize()
 }
 
 
+// Stop the song if it has ended
+void ConsolePlayer::checkEnd()
+{
+    const uint_least32_t milliseconds = m_engine.timeMs();
+#ifdef FEAT_REGS_DUMP_SID
+    for (unsigned int sid = 0; sid < endDetector::MAX_SIDS; sid++)
+    {
+        uint8_t registers[32];
+        if (m_engine.getSidStatus(sid, registers))
+            m_endDetector.registers(sid, registers, milliseconds);
+    }
+#endif
+
+    uint_least32_t end;
+    if (m_endDetector.check(milliseconds, end))
+    {
+        m_detectedLength = end;
+        m_endDetector.reset(0);
+
+        // The output already goes past the end,
+        // drop the silence after it
+        const uint_least64_t frames = (end > m_timer.start)
+            ? (static_cast<uint_least64_t>(end - m_timer.start) * m_driver.cfg.frequency) / 1000 : 0;
+        if (m_driver.file)
+            m_driver.device->setEnd(frames);
+        m_cache.setEnd(frames);
+        // zero would mean endless
+        m_timer.stop = end ? end : milliseconds;
+    }
+}
+
+// Stop at the end of the first loop
+void ConsolePlayer::checkLoop(MAYBE_UNUSED unsigned int samples)
+{
+#ifdef FEAT_REGS_DUMP_SID
+    m_loopPosition += samples;
+    for (unsigned int sid = 0; sid < loopDetector::MAX_SIDS; sid++)
+    {
+        uint8_t registers[32];
+        if (m_engine.getSidStatus(sid, registers))
+            m_loopDetector.registers(sid, registers);
+    }
+
+    if (m_loopDetector.endFrame(m_loopPosition))
+    {
+        // The output already goes past the loop end
+        m_driver.device->setLoop(m_loopDetector.loopStart(), m_loopDetector.loopEnd());
+        m_timer.stop = m_engine.timeMs();
+    }
+#endif
+}
+
+// Look for a previous render with the same tune and settings,
+// otherwise start recording this one
+void ConsolePlayer::openCache(uint_least32_t endDetectTime)
+{
+    settingsHash hash;
+    hash << RENDER_CACHE_VERSION
+        << LIBSIDPLAYFP_VERSION_MAJ << LIBSIDPLAYFP_VERSION_MIN << LIBSIDPLAYFP_VERSION_LEV;
+
+    hash << m_engCfg.defaultC64Model << m_engCfg.forceC64Model
+        << m_engCfg.defaultSidModel << m_engCfg.forceSidModel
+        << m_engCfg.digiBoost << m_engCfg.ciaModel << m_engCfg.playback
+        << m_engCfg.secondSidAddress << m_engCfg.thirdSidAddress
+        << m_engCfg.powerOnDelay << m_engCfg.samplingMethod << m_engCfg.fastSampling;
+    for (const std::string &rom : { (m_iniCfg.sidplay2()).kernalRom,
+                                    (m_iniCfg.sidplay2()).basicRom,
+                                    (m_iniCfg.sidplay2()).chargenRom })
+    {
+        hash.add(rom.data(), rom.size() + 1);
+    }
+
+    hash << m_driver.sid << m_filter.enabled << m_filter.bias << m_autofilter
+        << m_filter.filterCurve6581 << m_filter.filterCurve8580;
+    hash << m_fcurve.has_value() << (m_fcurve.has_value() ? m_fcurve.value() : 0.);
+#ifdef FEAT_FILTER_RANGE
+    hash << m_filter.filterRange6581;
+    hash << m_frange.has_value() << (m_frange.has_value() ? m_frange.value() : 0.);
+#endif
+#ifdef FEAT_CW_STRENGTH
+    hash << m_combinedWaveformsStrength;
+#endif
+#ifdef FEAT_RESID_CAPS
+    hash << m_old6581Caps;
+#endif
+
+    hash << m_mute_channel.to_ulong();
+#ifdef FEAT_SAMPLE_MUTE
+    hash << m_mute_samples.to_ulong();
+#endif
+#ifdef FEAT_NEW_PLAY_API
+    for (int chip=0; chip<3; chip++)
+        hash << m_panning[chip];
+    hash << m_fadeoutTime;
+#endif
+
+    hash << m_driver.cfg.frequency << m_driver.cfg.channels << m_driver.cfg.bufSize;
+    hash << m_timer.start << m_timer.stop << endDetectTime;
+
+    char md5[SidTune::MD5_LENGTH + 1];
+    const std::string key = fmt::format("{}-{}-{:016x}",
+        m_tune.createMD5New(md5), m_track.selected, hash.value());
+
+    if (!m_cache.open(key, m_driver.cfg.frequency, m_driver.cfg.channels))
+        return;
+
+    // Go straight to the output, the cached render
+    // already starts at the requested time
+    m_timer.starting  = false;
+    m_driver.selected = m_driver.device;
+    m_driver.discard  = m_driver.selected->discard();
+    m_driver.selected->clearBuffer();
+    m_speed.current   = 1;
+
+    // The render has its own end
+    m_endDetector.reset(0);
+    m_timer.stop = 0;
+    if (m_driver.file)
+        m_driver.device->setLength((m_cache.frames() * 1000) / m_driver.cfg.frequency);
+}
+
+// Play time when streaming from the cache
+uint_least32_t ConsolePlayer::cachedTimeMs() const
+{
+    const uint_least64_t frequency = m_driver.cfg.frequency;
+    return m_timer.start + static_cast<uint_least32_t>((m_cache.position() * 1000 + frequency - 1) / frequency);
+}
+
 // External Timer Event
 void ConsolePlayer::updateDisplay()
 {
-    const uint_least32_t milliseconds = m_engine.timeMs();
+    const uint_least32_t milliseconds = m_cache.reading() ? cachedTimeMs() : m_engine.timeMs();
     const uint_least32_t seconds = milliseconds / 1000;
 
     refreshRegDump();
@@ -1286,6 +1784,10 @@ void ConsolePlayer::displayError(const char *error) const
 // Keyboard handling
 void ConsolePlayer::decodeKeys ()
 {
+    // Keys change the output, it can't be cached anymore
+    if (m_cache.writing())
+        m_cache.close();
+
     do
     {
         const int action = keyboard_decode ();
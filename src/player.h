@@ -36,6 +36,11 @@
 #include "audio/AudioConfig.h"
 #include "audio/null/null.h"
 #include "IniConfig.h"
+#include "endDetector.h"
+#include "loudness.h"
+#include "loopDetector.h"
+#include "renderCache.h"
+#include "startupProfile.h"
 
 #include "setting.h"
 
@@ -48,6 +53,7 @@
 
 #include <string>
 #include <bitset>
+#include <chrono>
 
 #ifdef HAVE_TSID
 #  if HAVE_TSID > 1
@@ -58,6 +64,13 @@
 #  endif
 #endif
 
+#ifdef FEAT_NEW_PLAY_API
+// Limits for the cycles to run at once,
+// the emulation buffers hold about 100ms of audio
+constexpr int MIN_CYCLES = 100;
+constexpr int MAX_CYCLES = 20000;
+#endif
+
 typedef enum
 {
     playerError = 0,
@@ -100,6 +113,8 @@ enum class output_t
     /* File creation support */
     WAV,
     AU,
+    FLAC,
+    RAW,
     END
 };
 
@@ -140,6 +155,10 @@ private:
 #ifdef HAVE_SIDPLAYFP_BUILDERS_USBSID_H
     static const char  USBSID_ID[];
 #endif
+    // first, to time the construction of the others
+    startupProfile     m_profile;
+    bool               m_startupProfile;
+
 #ifdef HAVE_TSID
     TSID               m_tsid;
 #endif
@@ -202,9 +221,59 @@ private:
     int  m_channels;
     int  m_precision;
     int  m_buffer_size;
+    int  m_queue_depth;
 #ifdef FEAT_NEW_PLAY_API
     Mixer m_mixer;
+    // stereo position of each chip, negative for default
+    double m_panning[3];
+    // cycles to emulate at once
+    Setting<int>       m_chunk;
+    unsigned int       m_cycles;
 #endif
+    // start of emulation, for statistics
+    std::chrono::steady_clock::time_point m_startTime;
+
+    // end detection for tunes with unknown length
+    endDetector                  m_endDetector;
+    Setting<uint_least32_t>      m_endDetectTime;
+    uint_least32_t               m_detectedLength;
+
+    // render only up to the end of the first loop
+    loopDetector                 m_loopDetector;
+    bool                         m_singleLoop;
+    // output frames produced so far
+    uint_least64_t               m_loopPosition;
+
+    // loudness of the output
+    loudnessMeter                m_loudness;
+    bool                         m_measureLoudness;
+
+    // previously rendered songs, file output only
+    renderCache                  m_cache;
+    Setting<int>                 m_cacheSize;
+
+    // ROMs are loaded when the first tune needing them is played
+    bool                         m_romsLoaded;
+    bool                         m_basicLoaded;
+
+    // scheduling of the playback thread, set up before the first song
+    Setting<int>                 m_rtPriority;
+    Setting<bool>                m_rtRoundRobin;
+    Setting<int>                 m_cpuAffinity;
+    Setting<bool>                m_lockMemory;
+    bool                         m_realtimeDone;
+
+    // abort on heap allocations once the playback has settled, debug builds only
+    bool                         m_allocCheck;
+    bool                         m_steadyState;
+
+    // emulation speed over the first seconds of playback,
+    // a cheaper emulation is selected if it can't keep up
+    Setting<bool>                m_autoFallback;
+    bool                         m_measureSpeed;
+    uint_least32_t               m_measuredFrames;
+    std::chrono::steady_clock::duration m_emulationTime;
+
     struct m_filter_t
     {
         // Filter parameter for reSID
@@ -227,6 +296,7 @@ private:
         bool           info;     // File metadata
         AudioConfig    cfg;
         IAudio*        selected; // Selected Output Driver
+        bool           discard;  // Selected driver ignores output
         IAudio*        device;   // HW/File Driver
         Audio_Null     null;     // Used for everything
     } m_driver;
@@ -271,6 +341,13 @@ private:
     void emuflush       (void);
     void menu           (void);
     void refreshRegDump ();
+    void checkEnd       ();
+    void checkLoop      (unsigned int samples);
+    void loadRoms       (const SidTuneInfo *tuneInfo);
+    void setupRealtime  ();
+    void checkSpeed     (std::chrono::steady_clock::duration elapsed, uint_least32_t frames);
+    void openCache      (uint_least32_t endDetectTime);
+    uint_least32_t cachedTimeMs() const;
 
     uint_least32_t getBufSize();
 
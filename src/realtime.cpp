@@ -0,0 +1,156 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "realtime.h"
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+
+#include <fmt/format.h>
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <pthread.h>
+#  include <sched.h>
+#  ifdef HAVE_MLOCKALL
+#    include <sys/mman.h>
+#  endif
+#endif
+
+namespace realtime
+{
+
+// Deep enough for the emulation and the output code
+static constexpr std::size_t STACK_PREFAULT = 256 * 1024;
+
+bool setPriority(int priority, bool roundRobin, std::string &result)
+{
+#if defined(_WIN32)
+    (void)priority;
+    (void)roundRobin;
+    if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL))
+    {
+        result = fmt::format("failed (error {})", GetLastError());
+        return false;
+    }
+    result = "time critical";
+    return true;
+#elif defined(HAVE_PTHREAD_SETSCHEDPARAM)
+    const int policy = roundRobin ? SCHED_RR : SCHED_FIFO;
+    const int minPriority = sched_get_priority_min(policy);
+    const int maxPriority = sched_get_priority_max(policy);
+    if ((priority < minPriority) || (priority > maxPriority))
+    {
+        result = fmt::format("failed (priority must be from {} to {})", minPriority, maxPriority);
+        return false;
+    }
+
+    struct sched_param param;
+    std::memset(&param, 0, sizeof(param));
+    param.sched_priority = priority;
+    const int err = pthread_setschedparam(pthread_self(), policy, &param);
+    if (err != 0)
+    {
+        result = fmt::format("failed ({})", std::strerror(err));
+        return false;
+    }
+    result = fmt::format("{} {}", roundRobin ? "SCHED_RR" : "SCHED_FIFO", priority);
+    return true;
+#else
+    (void)priority;
+    (void)roundRobin;
+    result = "not supported";
+    return false;
+#endif
+}
+
+bool setAffinity(int cpu, std::string &result)
+{
+#if defined(_WIN32)
+    if ((cpu < 0) || (cpu >= static_cast<int>(sizeof(DWORD_PTR) * 8)))
+    {
+        result = "failed (invalid processor)";
+        return false;
+    }
+    if (SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << cpu) == 0)
+    {
+        result = fmt::format("failed (error {})", GetLastError());
+        return false;
+    }
+    result = fmt::format("cpu {}", cpu);
+    return true;
+#elif defined(HAVE_PTHREAD_SETAFFINITY_NP)
+    if ((cpu < 0) || (cpu >= CPU_SETSIZE))
+    {
+        result = "failed (invalid processor)";
+        return false;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    const int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err != 0)
+    {
+        result = fmt::format("failed ({})", std::strerror(err));
+        return false;
+    }
+    result = fmt::format("cpu {}", cpu);
+    return true;
+#else
+    (void)cpu;
+    result = "not supported";
+    return false;
+#endif
+}
+
+bool lockMemory(std::string &result)
+{
+#ifdef HAVE_MLOCKALL
+    // Locking the current pages also faults them in
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    {
+        result = fmt::format("failed ({})", std::strerror(errno));
+        return false;
+    }
+    result = "locked";
+    return true;
+#else
+    result = "not supported";
+    return false;
+#endif
+}
+
+void prefaultStack()
+{
+    unsigned char stack[STACK_PREFAULT];
+    // Volatile so the writes are not optimized away
+    volatile unsigned char *page = stack;
+    for (std::size_t i = 0; i < STACK_PREFAULT; i += 4096)
+        page[i] = 0;
+}
+
+}
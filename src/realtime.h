@@ -0,0 +1,63 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef REALTIME_H
+#define REALTIME_H
+
+#include <string>
+
+/*
+ * Settings that keep the thread producing the audio from being
+ * preempted or paged out. Each function reports what happened
+ * in the result string, they fail when the platform doesn't
+ * support the setting or the process lacks the privileges.
+ */
+namespace realtime
+{
+
+/**
+ * Switch the calling thread to real time scheduling.
+ *
+ * @param priority the static priority, 1 to 99
+ * @param roundRobin use SCHED_RR instead of SCHED_FIFO
+ */
+bool setPriority(int priority, bool roundRobin, std::string &result);
+
+/**
+ * Pin the calling thread to a processor.
+ *
+ * @param cpu the processor number, starting from 0
+ */
+bool setAffinity(int cpu, std::string &result);
+
+/**
+ * Lock the current and future memory of the process.
+ */
+bool lockMemory(std::string &result);
+
+/**
+ * Touch the stack the thread may use so that
+ * it doesn't fault later.
+ */
+void prefaultStack();
+
+}
+
+#endif // REALTIME_H
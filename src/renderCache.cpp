@@ -0,0 +1,247 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "renderCache.h"
+
+#include <algorithm>
+#include <system_error>
+#include <vector>
+
+#include <cstring>
+
+#include "utils.h"
+
+namespace fs = ghc::filesystem;
+
+// FNV-1a
+static constexpr uint_least64_t HASH_OFFSET = 0xcbf29ce484222325ULL;
+static constexpr uint_least64_t HASH_PRIME = 0x100000001b3ULL;
+
+static const char MAGIC[8] = { 'S', 'P', 'F', 'C', 'A', 'C', 'H', 'E' };
+static const char EXTENSION[] = ".pcm";
+
+struct cacheHeader
+{
+    char magic[8];
+    uint8_t frequency[4];
+    uint8_t channels[4];
+};
+
+settingsHash::settingsHash() :
+    m_hash(HASH_OFFSET)
+{}
+
+void settingsHash::add(const void *data, std::size_t length)
+{
+    const uint8_t *bytes = static_cast<const uint8_t*>(data);
+    for (std::size_t i = 0; i < length; i++)
+    {
+        m_hash ^= bytes[i];
+        m_hash *= HASH_PRIME;
+    }
+}
+
+static void setHeader(cacheHeader &header, uint_least32_t frequency, unsigned int channels)
+{
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    for (int i = 0; i < 4; i++)
+    {
+        header.frequency[i] = static_cast<uint8_t>(frequency >> (i * 8));
+        header.channels[i] = static_cast<uint8_t>(channels >> (i * 8));
+    }
+}
+
+void renderCache::setup(const std::string &dir, uint_least64_t limit)
+{
+    close();
+    m_dir = dir;
+    m_limit = limit;
+}
+
+bool renderCache::open(const std::string &key, uint_least32_t frequency, unsigned int channels)
+{
+    close();
+    if (!enabled())
+        return false;
+
+    m_path = m_dir / (key + EXTENSION);
+    m_channels = channels;
+    m_frames = 0;
+    m_position = 0;
+    m_end = ~static_cast<uint_least64_t>(0);
+
+    cacheHeader expected;
+    setHeader(expected, frequency, channels);
+
+    m_input.open(m_path, std::ios::in | std::ios::binary);
+    if (m_input.is_open())
+    {
+        cacheHeader header;
+        m_input.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!m_input.fail() && (std::memcmp(&header, &expected, sizeof(header)) == 0))
+        {
+            std::error_code ec;
+            const uintmax_t size = fs::file_size(m_path, ec);
+            if (!ec)
+                m_frames = (size - sizeof(header)) / (channels * sizeof(short));
+
+            // Mark as recently used
+            fs::last_write_time(m_path, fs::file_time_type::clock::now(), ec);
+            return true;
+        }
+        m_input.close();
+    }
+
+    // Write to a unique name so that concurrent
+    // players don't mix up their output
+    std::error_code ec;
+    fs::create_directories(m_dir, ec);
+    m_tempPath = utils::tempName(m_path.string());
+
+    m_output.open(m_tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (m_output.is_open())
+    {
+        m_output.write(reinterpret_cast<const char*>(&expected), sizeof(expected));
+        if (m_output.fail())
+            close();
+    }
+    return false;
+}
+
+uint_least32_t renderCache::read(short *buffer, uint_least32_t frames)
+{
+    if (!reading())
+        return 0;
+
+    m_input.read(reinterpret_cast<char*>(buffer), frames * m_channels * sizeof(short));
+    const uint_least32_t read = m_input.gcount() / (m_channels * sizeof(short));
+    m_position += read;
+    return read;
+}
+
+void renderCache::write(const short *buffer, uint_least32_t frames)
+{
+    if (!writing())
+        return;
+
+    m_output.write(reinterpret_cast<const char*>(buffer), frames * m_channels * sizeof(short));
+    if (m_output.fail())
+        close();
+    else
+        m_position += frames;
+}
+
+void renderCache::commit()
+{
+    if (!writing())
+        return;
+
+    m_output.close();
+    std::error_code ec;
+    if (m_output.fail() || (m_position == 0) || (m_end == 0))
+    {
+        fs::remove(m_tempPath, ec);
+        return;
+    }
+
+    if (m_end < m_position)
+    {
+        fs::resize_file(m_tempPath, sizeof(cacheHeader) + m_end * m_channels * sizeof(short), ec);
+        if (ec)
+        {
+            fs::remove(m_tempPath, ec);
+            return;
+        }
+    }
+
+    fs::rename(m_tempPath, m_path, ec);
+    if (ec)
+    {
+        fs::remove(m_tempPath, ec);
+        return;
+    }
+
+    evict();
+}
+
+void renderCache::close()
+{
+    if (m_input.is_open())
+        m_input.close();
+
+    if (m_output.is_open())
+    {
+        m_output.close();
+        std::error_code ec;
+        fs::remove(m_tempPath, ec);
+    }
+}
+
+/*
+ * Remove the least recently used entries, by modification
+ * time which is refreshed on every hit, until the cache
+ * fits the limit.
+ */
+void renderCache::evict()
+{
+    struct entry
+    {
+        fs::path path;
+        fs::file_time_type time;
+        uint_least64_t size;
+    };
+
+    std::vector<entry> entries;
+    uint_least64_t total = 0;
+
+    std::error_code ec;
+    for (fs::directory_iterator it(m_dir, ec), end; !ec && (it != end); it.increment(ec))
+    {
+        const fs::path &path = it->path();
+        if (path.extension() != EXTENSION)
+            continue;
+
+        entry e;
+        e.path = path;
+        e.time = it->last_write_time(ec);
+        e.size = it->file_size(ec);
+        if (ec)
+        {
+            ec.clear();
+            continue;
+        }
+        total += e.size;
+        entries.push_back(e);
+    }
+
+    if (total <= m_limit)
+        return;
+
+    std::sort(entries.begin(), entries.end(),
+        [](const entry &a, const entry &b) { return a.time < b.time; });
+
+    for (const entry &e : entries)
+    {
+        if (total <= m_limit)
+            break;
+        if (fs::remove(e.path, ec))
+            total -= e.size;
+    }
+}
@@ -0,0 +1,130 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef RENDERCACHE_H
+#define RENDERCACHE_H
+
+#include "filesystem/filesystem.hpp"
+
+#include <string>
+
+#include <cstddef>
+#include <stdint.h>
+
+/**
+ * Hash of the settings that affect the rendered audio.
+ */
+class settingsHash
+{
+private:
+    uint_least64_t m_hash;
+
+public:
+    settingsHash();
+
+    void add(const void *data, std::size_t length);
+
+    template<typename T>
+    settingsHash &operator<<(T value) { add(&value, sizeof(value)); return *this; }
+
+    uint_least64_t value() const { return m_hash; }
+};
+
+/**
+ * On-disk cache of rendered songs.
+ *
+ * Each entry holds the 16 bit samples as produced by the mixer,
+ * keyed by the tune MD5, the song number and a hash of
+ * the settings. A new entry is written while the song is
+ * being rendered and is only added once complete, then
+ * the least recently used entries are evicted to keep
+ * the cache under its size limit.
+ */
+class renderCache
+{
+private:
+    ghc::filesystem::path m_dir;
+    uint_least64_t m_limit;
+
+    ghc::filesystem::ifstream m_input;
+    ghc::filesystem::ofstream m_output;
+    ghc::filesystem::path m_path;
+    ghc::filesystem::path m_tempPath;
+
+    unsigned int m_channels;
+    uint_least64_t m_frames;
+    uint_least64_t m_position;
+    uint_least64_t m_end;
+
+private:
+    void evict();
+
+public:
+    renderCache() : m_limit(0), m_channels(0), m_frames(0), m_position(0), m_end(0) {}
+    ~renderCache() { close(); }
+
+    /**
+     * Set the cache location.
+     *
+     * @param dir the cache directory
+     * @param limit the size limit in bytes, zero disables the cache
+     */
+    void setup(const std::string &dir, uint_least64_t limit);
+
+    bool enabled() const { return m_limit != 0; }
+
+    /**
+     * Look for a cached render, if found it's opened for reading
+     * otherwise a new entry is started.
+     *
+     * @return true if the song can be read from the cache
+     */
+    bool open(const std::string &key, uint_least32_t frequency, unsigned int channels);
+
+    bool reading() const { return m_input.is_open(); }
+    bool writing() const { return m_output.is_open(); }
+
+    /**
+     * Read the next samples.
+     *
+     * @return the number of frames read, zero at the end
+     */
+    uint_least32_t read(short *buffer, uint_least32_t frames);
+
+    /// Append the rendered samples.
+    void write(const short *buffer, uint_least32_t frames);
+
+    /// Length of the cached render in frames.
+    uint_least64_t frames() const { return m_frames; }
+
+    /// Frames read or written so far.
+    uint_least64_t position() const { return m_position; }
+
+    /// Drop the written samples past the given frame.
+    void setEnd(uint_least64_t frames) { m_end = frames; }
+
+    /// Add the completed render to the cache.
+    void commit();
+
+    /// Stop reading, or drop the render being written.
+    void close();
+};
+
+#endif // RENDERCACHE_H
@@ -0,0 +1,174 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2011-2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "romLoader.h"
+
+#include "filesystem/filesystem.hpp"
+
+#include <map>
+#include <mutex>
+#include <new>
+
+#include "utils.h"
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#if !defined _WIN32 && defined HAVE_UNISTD_H
+#  include <unistd.h>
+#endif
+
+#ifdef HAVE_MMAP
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#endif
+
+#undef SEPARATOR
+#define SEPARATOR "/"
+
+namespace fs = ghc::filesystem;
+
+romImage::~romImage()
+{
+#ifdef HAVE_MMAP
+    if (m_mapped)
+        ::munmap(const_cast<uint8_t*>(m_data), m_mapped);
+#endif
+}
+
+std::unique_ptr<romImage> romImage::open(const std::string &path, const int size)
+{
+    std::unique_ptr<romImage> image;
+    try
+    {
+        image.reset(new romImage());
+    }
+    catch (std::bad_alloc const &ba)
+    {
+        return nullptr;
+    }
+
+#ifdef HAVE_MMAP
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat st;
+    void *data = MAP_FAILED;
+    if ((::fstat(fd, &st) == 0) && (st.st_size >= size))
+        data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (data != MAP_FAILED)
+    {
+        image->m_data = static_cast<const uint8_t*>(data);
+        image->m_mapped = size;
+        return image;
+    }
+#endif
+
+    fs::ifstream is(path, std::ios::binary);
+
+    if (is.is_open())
+    {
+        try
+        {
+            image->m_buffer.reset(new uint8_t[size]);
+
+            is.read((char*)image->m_buffer.get(), size);
+            if (!is.fail())
+            {
+                image->m_data = image->m_buffer.get();
+                return image;
+            }
+        }
+        catch (std::bad_alloc const &ba) {}
+    }
+
+    return nullptr;
+}
+
+
+static std::unique_ptr<romImage> findRom(const std::string &romPath, const int size, const char* defaultRom)
+{
+    // Try to load given rom
+    if (!romPath.empty())
+    {
+        std::unique_ptr<romImage> image = romImage::open(romPath, size);
+        if (image)
+            return image;
+    }
+
+    // Fallback to default rom path
+    try
+    {
+#ifdef _WIN32
+        {
+            // Try exec dir first
+            std::string execPath(utils::getExecPath());
+            execPath.append(SEPARATOR).append(defaultRom);
+            std::unique_ptr<romImage> image = romImage::open(execPath, size);
+            if (image)
+                return image;
+        }
+#endif
+        std::string dataPath(utils::getDataPath());
+
+        dataPath.append(SEPARATOR).append("sidplayfp").append(SEPARATOR).append(defaultRom);
+
+#if !defined _WIN32 && defined HAVE_UNISTD_H
+        if (::access(dataPath.c_str(), R_OK) != 0)
+        {
+            dataPath = PKGDATADIR;
+            dataPath.append(defaultRom);
+        }
+#endif
+
+        return romImage::open(dataPath, size);
+    }
+    catch (utils::error const &e)
+    {
+        return nullptr;
+    }
+}
+
+
+std::shared_ptr<const romImage> loadRom(const std::string &romPath, const int size, const char* defaultRom)
+{
+    static std::mutex lock;
+    static std::map<std::string, std::shared_ptr<const romImage>> images;
+
+    std::string key(defaultRom);
+    key.append(1, '\0').append(romPath);
+
+    std::lock_guard<std::mutex> guard(lock);
+
+    // Missing images are remembered too, so the
+    // search is done only once
+    auto it = images.find(key);
+    if (it != images.end())
+        return it->second;
+
+    std::shared_ptr<const romImage> image(findRom(romPath, size, defaultRom));
+    images.emplace(key, image);
+    return image;
+}
@@ -0,0 +1,76 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2011-2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef ROMLOADER_H
+#define ROMLOADER_H
+
+#include <memory>
+#include <string>
+
+#include <cstddef>
+#include <stdint.h>
+
+/**
+ * A read-only ROM image, mapped from its file
+ * where supported, otherwise copied into memory.
+ */
+class romImage
+{
+private:
+    const uint8_t *m_data;
+    /// Length of the mapping, zero if copied
+    std::size_t m_mapped;
+    std::unique_ptr<uint8_t[]> m_buffer;
+
+private:
+    romImage() : m_data(nullptr), m_mapped(0) {}
+    romImage(const romImage&) = delete;
+    romImage& operator=(const romImage&) = delete;
+
+public:
+    ~romImage();
+
+    const uint8_t *data() const { return m_data; }
+
+    /**
+     * Open the image.
+     *
+     * @param path the file
+     * @param size the size of the image
+     * @return the image or nullptr if the file can't be read
+     */
+    static std::unique_ptr<romImage> open(const std::string &path, const int size);
+};
+
+/**
+ * Load a ROM image.
+ *
+ * Images are loaded on first request and then shared
+ * by all the callers for the life of the process.
+ *
+ * @param romPath the configured path, may be empty
+ * @param size the size of the image
+ * @param defaultRom the file name looked up in the data dirs
+ *        if the configured path doesn't work
+ * @return the image or nullptr if not found
+ */
+std::shared_ptr<const romImage> loadRom(const std::string &romPath, const int size, const char* defaultRom);
+
+#endif // ROMLOADER_H
@@ -0,0 +1,603 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+//
+// sidlengths - songlength database generator
+//
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <fmt/format.h>
+
+#include "filesystem/filesystem.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <sidplayfp/sidplayfp.h>
+#include <sidplayfp/SidConfig.h>
+#include <sidplayfp/SidTune.h>
+#include <sidplayfp/SidTuneInfo.h>
+
+#ifdef HAVE_SIDPLAYFP_BUILDERS_RESIDFP_H
+#  include <sidplayfp/builders/residfp.h>
+#endif
+
+#ifdef HAVE_SIDPLAYFP_BUILDERS_SIDLITE_H
+#  include <sidplayfp/builders/sidlite.h>
+#endif
+
+#include "IniConfig.h"
+#include "endDetector.h"
+#include "loopDetector.h"
+#include "romLoader.h"
+#include "sidlib_features.h"
+#include "tuneBatch.h"
+
+#include "sidcxx11.h"
+
+namespace fs = ghc::filesystem;
+
+// Cycles per video frame
+constexpr unsigned int FRAME_CYCLES_PAL = 63 * 312;
+constexpr unsigned int FRAME_CYCLES_NTSC = 65 * 263;
+
+enum class emu_t
+{
+    RESIDFP,
+    SIDLITE
+};
+
+enum class found_t
+{
+    END,
+    LOOP,
+    LIMIT,
+    FAIL
+};
+
+struct options_t
+{
+    std::string    root;
+    std::string    output = "Songlengths.md5";
+    unsigned int   threads = 0;
+    uint_least32_t maxLength = 10 * 60 * 1000;
+    uint_least32_t detectTime = 5 * 1000;
+    emu_t          emulation =
+#ifdef HAVE_SIDPLAYFP_BUILDERS_SIDLITE_H
+        emu_t::SIDLITE;
+#else
+        emu_t::RESIDFP;
+#endif
+    bool           verbose = false;
+};
+
+struct subtune_t
+{
+    uint_least32_t length;
+    found_t        found;
+};
+
+struct entry_t
+{
+    std::string            path;
+    std::string            md5;
+    std::vector<subtune_t> subtunes;
+};
+
+/*
+ * Everything shared by the workers, read-only
+ * once the scan starts.
+ */
+struct context_t
+{
+    options_t                 options;
+    IniConfig                 ini;
+    std::shared_ptr<const romImage> kernalRom;
+    std::shared_ptr<const romImage> basicRom;
+    std::shared_ptr<const romImage> chargenRom;
+
+    std::vector<entry_t>      entries;
+    std::atomic<std::size_t>  next;
+    std::atomic<std::size_t>  done;
+    std::mutex                printLock;
+};
+
+static void printUsage(const char *name)
+{
+    fmt::print("Syntax: {} [-<option>...] <directory>\n", name);
+    fmt::print("Options:\n"
+        " --help|-h    display this screen\n"
+        " -o<file>     output database (default: Songlengths.md5, - for stdout)\n"
+        " -j<num>      number of threads (default: number of cores)\n"
+        " -t<num>      longest time to emulate in seconds (default: 600)\n"
+        " -s<num>      stop after <num> seconds of silence or inactivity (default: 5)\n"
+#ifdef HAVE_SIDPLAYFP_BUILDERS_RESIDFP_H
+        " --residfp    use reSIDfp emulation\n"
+#endif
+#ifdef HAVE_SIDPLAYFP_BUILDERS_SIDLITE_H
+        " --sidlite    use sidlite emulation (default)\n"
+#endif
+        " -v           print the length of each song\n"
+        "\n");
+}
+
+static bool parseSeconds(const char *str, uint_least32_t &time)
+{
+    char *end;
+    const long seconds = std::strtol(str, &end, 10);
+    if ((end == str) || (*end != '\0') || (seconds <= 0) || (seconds > 99 * 60))
+        return false;
+    time = static_cast<uint_least32_t>(seconds) * 1000;
+    return true;
+}
+
+static bool parseArgs(int argc, char **argv, options_t &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        if ((arg[0] != '-') || (arg[1] == '\0'))
+        {
+            if (!options.root.empty())
+                return false;
+            options.root = arg;
+        }
+        else if ((std::strcmp(arg, "-h") == 0) || (std::strcmp(arg, "--help") == 0))
+        {
+            return false;
+        }
+        else if (arg[1] == 'o')
+        {
+            if (arg[2] == '\0')
+                return false;
+            options.output = &arg[2];
+        }
+        else if (arg[1] == 'j')
+        {
+            if (!parseThreads(&arg[2], options.threads))
+                return false;
+        }
+        else if (arg[1] == 't')
+        {
+            if (!parseSeconds(&arg[2], options.maxLength))
+                return false;
+        }
+        else if (arg[1] == 's')
+        {
+            if (!parseSeconds(&arg[2], options.detectTime))
+                return false;
+        }
+#ifdef HAVE_SIDPLAYFP_BUILDERS_RESIDFP_H
+        else if (std::strcmp(arg, "--residfp") == 0)
+        {
+            options.emulation = emu_t::RESIDFP;
+        }
+#endif
+#ifdef HAVE_SIDPLAYFP_BUILDERS_SIDLITE_H
+        else if (std::strcmp(arg, "--sidlite") == 0)
+        {
+            options.emulation = emu_t::SIDLITE;
+        }
+#endif
+        else if (std::strcmp(arg, "-v") == 0)
+        {
+            options.verbose = true;
+        }
+        else
+        {
+            fmt::print(stderr, "ERROR: Unknown argument: '{}'\n", arg);
+            return false;
+        }
+    }
+
+    return !options.root.empty();
+}
+
+/*
+ * List the tunes below the root, sorted by their
+ * HVSC style path.
+ */
+static bool scanTree(context_t &ctx)
+{
+    std::vector<std::string> paths;
+    std::string error;
+    if (!scanTunes(ctx.options.root, paths, error))
+    {
+        fmt::print(stderr, "ERROR: Cannot read directory {}: {}\n", ctx.options.root, error);
+        return false;
+    }
+
+    ctx.entries.resize(paths.size());
+    for (std::size_t i = 0; i < paths.size(); i++)
+        ctx.entries[i].path = std::move(paths[i]);
+    return true;
+}
+
+#if defined(FEAT_NEW_PLAY_API) && defined(FEAT_REGS_DUMP_SID)
+
+/*
+ * One emulation instance per thread.
+ */
+class worker
+{
+private:
+    context_t    &m_ctx;
+    sidplayfp     m_engine;
+    SidConfig     m_config;
+    sidbuilder   *m_builder;
+    std::vector<short> m_mix;
+
+    endDetector  m_endDetector;
+    loopDetector m_loopDetector;
+
+private:
+    subtune_t emulate(SidTune &tune);
+    void process(entry_t &entry);
+
+public:
+    explicit worker(context_t &ctx);
+    ~worker();
+
+    bool init();
+    void run();
+};
+
+worker::worker(context_t &ctx) :
+    m_ctx(ctx),
+    m_builder(nullptr)
+{}
+
+worker::~worker()
+{
+    if (m_builder)
+    {
+        m_config.sidEmulation = nullptr;
+        m_engine.config(m_config);
+        delete m_builder;
+    }
+}
+
+bool worker::init()
+{
+    const IniConfig::emulation_section &emulation = m_ctx.ini.emulation();
+
+    m_config = m_engine.config();
+    m_config.forceC64Model   = emulation.modelForced;
+    m_config.defaultC64Model = emulation.modelDefault;
+    m_config.defaultSidModel = emulation.sidModel;
+    m_config.forceSidModel   = emulation.forceModel;
+    m_config.ciaModel        = emulation.ciaModel;
+    m_config.digiBoost       = emulation.digiboost;
+    m_config.frequency       = m_ctx.ini.audio().frequency;
+    // Only the timing matters, the quality of the output doesn't
+    m_config.samplingMethod  = SidConfig::INTERPOLATE;
+    m_config.playback        = SidConfig::MONO;
+    if (emulation.powerOnDelay >= 0)
+        m_config.powerOnDelay = emulation.powerOnDelay;
+
+    try
+    {
+        switch (m_ctx.options.emulation)
+        {
+#ifdef HAVE_SIDPLAYFP_BUILDERS_RESIDFP_H
+        case emu_t::RESIDFP:
+        {
+            ReSIDfpBuilder *rs = new ReSIDfpBuilder("ReSIDfp");
+            m_builder = rs;
+#ifndef FEAT_NO_CREATE
+            if (rs->getStatus())
+                rs->create((m_engine.info()).maxsids());
+#endif
+            rs->filter6581Curve(emulation.filterCurve6581);
+#ifdef FEAT_FILTER_RANGE
+            rs->filter6581Range(emulation.filterRange6581);
+#endif
+            rs->filter8580Curve(emulation.filterCurve8580);
+#ifdef FEAT_CW_STRENGTH
+            rs->combinedWaveformsStrength(emulation.combinedWaveformsStrength);
+#endif
+            break;
+        }
+#endif
+#ifdef HAVE_SIDPLAYFP_BUILDERS_SIDLITE_H
+        case emu_t::SIDLITE:
+            m_builder = new SIDLiteBuilder("SidLite");
+            break;
+#endif
+        default:
+            break;
+        }
+    }
+    catch (std::bad_alloc const &ba) {}
+
+    if (!m_builder || !m_builder->getStatus())
+    {
+        fmt::print(stderr, "ERROR: Cannot create the SID emulation\n");
+        return false;
+    }
+    m_builder->filter(emulation.filter);
+
+    m_config.sidEmulation = m_builder;
+    if (!m_engine.config(m_config))
+    {
+        fmt::print(stderr, "ERROR: {}\n", m_engine.error());
+        return false;
+    }
+
+    m_engine.setRoms(m_ctx.kernalRom ? m_ctx.kernalRom->data() : nullptr,
+                     m_ctx.basicRom ? m_ctx.basicRom->data() : nullptr,
+                     m_ctx.chargenRom ? m_ctx.chargenRom->data() : nullptr);
+    return true;
+}
+
+subtune_t worker::emulate(SidTune &tune)
+{
+    if (!m_engine.load(&tune))
+        return subtune_t { 0, found_t::FAIL };
+
+    const SidTuneInfo *tuneInfo = tune.getInfo();
+    const bool ntsc =
+        (
+            (m_config.defaultC64Model == SidConfig::NTSC) &&
+            (m_config.forceC64Model || (tuneInfo->clockSpeed() != SidTuneInfo::CLOCK_PAL))
+        ) ||
+        (tuneInfo->clockSpeed() == SidTuneInfo::CLOCK_NTSC);
+    // Look at the registers once per frame
+    const unsigned int cycles = ntsc ? FRAME_CYCLES_NTSC : FRAME_CYCLES_PAL;
+
+    const unsigned int sids = m_engine.installedSIDs();
+    short *buffers[3];
+    m_engine.buffers(buffers);
+
+    m_endDetector.reset(m_ctx.options.detectTime);
+    m_loopDetector.reset(true);
+    uint_least64_t position = 0;
+
+    uint_least32_t time = m_engine.timeMs();
+    while (time < m_ctx.options.maxLength)
+    {
+        const int samples = m_engine.play(cycles);
+        if (samples < 0)
+            return subtune_t { time, found_t::FAIL };
+
+        // Mix the chips to catch silence
+        if (m_mix.size() < static_cast<std::size_t>(samples))
+            m_mix.resize(samples);
+        for (int i = 0; i < samples; i++)
+        {
+            int sample = 0;
+            for (unsigned int sid = 0; sid < sids; sid++)
+                sample += buffers[sid][i];
+            m_mix[i] = static_cast<short>(std::min(std::max(sample, -32768), 32767));
+        }
+        m_endDetector.samples(m_mix.data(), samples, 1, time, m_config.frequency);
+
+        time = m_engine.timeMs();
+        position += samples;
+        for (unsigned int sid = 0; sid < sids; sid++)
+        {
+            uint8_t registers[32];
+            if (m_engine.getSidStatus(sid, registers))
+            {
+                m_endDetector.registers(sid, registers, time);
+                m_loopDetector.registers(sid, registers);
+            }
+        }
+
+        if (m_loopDetector.endFrame(position))
+        {
+            const uint_least32_t end = (m_loopDetector.loopEnd() * 1000) / m_config.frequency;
+            return subtune_t { end, found_t::LOOP };
+        }
+
+        uint_least32_t end;
+        if (m_endDetector.check(time, end))
+            return subtune_t { end, found_t::END };
+    }
+
+    return subtune_t { m_ctx.options.maxLength, found_t::LIMIT };
+}
+
+void worker::process(entry_t &entry)
+{
+    const std::string file = (fs::path(m_ctx.options.root) / fs::path(entry.path.substr(1))).string();
+    SidTune tune(file.c_str());
+    const std::size_t done = ++m_ctx.done;
+    if (!tune.getStatus())
+    {
+        std::lock_guard<std::mutex> lock(m_ctx.printLock);
+        fmt::print(stderr, "WARNING: {}: {}\n", entry.path, tune.statusString());
+        return;
+    }
+
+    char md5[SidTune::MD5_LENGTH + 1];
+    entry.md5 = tune.createMD5New(md5);
+
+    const unsigned int songs = tune.getInfo()->songs();
+    for (unsigned int song = 1; song <= songs; song++)
+    {
+        tune.selectSong(song);
+        entry.subtunes.push_back(emulate(tune));
+        if (entry.subtunes.back().found == found_t::FAIL)
+        {
+            std::lock_guard<std::mutex> lock(m_ctx.printLock);
+            fmt::print(stderr, "WARNING: {}: song {} failed to play, the file is left out\n",
+                entry.path, song);
+        }
+    }
+
+    if (m_ctx.options.verbose)
+    {
+        static const char *found[] = { "end", "loop", "limit", "error" };
+
+        std::lock_guard<std::mutex> lock(m_ctx.printLock);
+        fmt::print(stderr, "[{}/{}] {}\n", done, m_ctx.entries.size(), entry.path);
+        for (std::size_t i = 0; i < entry.subtunes.size(); i++)
+        {
+            const subtune_t &subtune = entry.subtunes[i];
+            fmt::print(stderr, "  #{} {}:{:02}.{:03} ({})\n", i + 1,
+                subtune.length / 60000, (subtune.length / 1000) % 60, subtune.length % 1000,
+                found[static_cast<int>(subtune.found)]);
+        }
+    }
+}
+
+void worker::run()
+{
+    for (;;)
+    {
+        const std::size_t index = m_ctx.next++;
+        if (index >= m_ctx.entries.size())
+            return;
+        process(m_ctx.entries[index]);
+    }
+}
+
+static bool runWorkers(context_t &ctx)
+{
+    const unsigned int threads = poolSize(ctx.options.threads, ctx.entries.size());
+
+    std::vector<std::unique_ptr<worker>> workers;
+    for (unsigned int i = 0; i < threads; i++)
+    {
+        std::unique_ptr<worker> w(new worker(ctx));
+        if (!w->init())
+            return false;
+        workers.push_back(std::move(w));
+    }
+
+    runPool(threads, [&workers](unsigned int i) { workers[i]->run(); });
+    return true;
+}
+
+#else
+
+static bool runWorkers(context_t &)
+{
+    fmt::print(stderr, "ERROR: This libsidplayfp version is not supported\n");
+    return false;
+}
+
+#endif
+
+// The lengths of a file are listed by song number,
+// a file with a failed song has no valid entry
+static bool failed(const entry_t &entry)
+{
+    for (const subtune_t &subtune : entry.subtunes)
+    {
+        if (subtune.found == found_t::FAIL)
+            return true;
+    }
+    return false;
+}
+
+static bool writeDatabase(const context_t &ctx, std::ostream &out)
+{
+    out << "[Database]\n";
+    for (const entry_t &entry : ctx.entries)
+    {
+        if (entry.md5.empty() || failed(entry))
+            continue;
+
+        out << "; " << entry.path << '\n' << entry.md5 << '=';
+        for (std::size_t i = 0; i < entry.subtunes.size(); i++)
+        {
+            const uint_least32_t length = entry.subtunes[i].length;
+            out << fmt::format("{}{}:{:02}.{:03}", i ? " " : "",
+                length / 60000, (length / 1000) % 60, length % 1000);
+        }
+        out << '\n';
+    }
+    out.flush();
+    return !out.fail();
+}
+
+int main(int argc, char **argv)
+{
+    context_t ctx;
+
+    if (!parseArgs(argc, argv, ctx.options))
+    {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    ctx.ini.read();
+    ctx.kernalRom = loadRom((ctx.ini.sidplay2()).kernalRom, 8192, "kernal");
+    ctx.basicRom = loadRom((ctx.ini.sidplay2()).basicRom, 8192, "basic");
+    ctx.chargenRom = loadRom((ctx.ini.sidplay2()).chargenRom, 4096, "chargen");
+
+    if (!scanTree(ctx))
+        return EXIT_FAILURE;
+    ctx.next = 0;
+    ctx.done = 0;
+
+    const auto startTime = std::chrono::steady_clock::now();
+    if (!runWorkers(ctx))
+        return EXIT_FAILURE;
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+
+    bool ok;
+    if (ctx.options.output.compare("-") == 0)
+    {
+        ok = writeDatabase(ctx, std::cout);
+    }
+    else
+    {
+        fs::ofstream out(ctx.options.output, std::ios::out | std::ios::trunc);
+        ok = out.is_open() && writeDatabase(ctx, out);
+    }
+    if (!ok)
+    {
+        fmt::print(stderr, "ERROR: Cannot write {}\n", ctx.options.output);
+        return EXIT_FAILURE;
+    }
+
+    unsigned int songs = 0;
+    unsigned int found[4] = { 0, 0, 0, 0 };
+    for (const entry_t &entry : ctx.entries)
+    {
+        for (const subtune_t &subtune : entry.subtunes)
+        {
+            songs++;
+            found[static_cast<int>(subtune.found)]++;
+        }
+    }
+    fmt::print(stderr, "{} files, {} songs in {:.1f}s: {} ended, {} looped, {} hit the limit, {} failed\n",
+        ctx.entries.size(), songs, elapsed.count(), found[0], found[1], found[2], found[3]);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,50 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "startupProfile.h"
+
+#include <fmt/format.h>
+
+void startupProfile::mark(const char *name)
+{
+    if (m_done)
+        return;
+
+    const clock::time_point now = clock::now();
+    if (m_count < MAX_PHASES)
+    {
+        m_phases[m_count].name = name;
+        m_phases[m_count].time = now - m_last;
+        m_count++;
+    }
+    m_last = now;
+}
+
+void startupProfile::print(std::FILE *out) const
+{
+    typedef std::chrono::duration<double, std::milli> ms;
+
+    fmt::print(out, "Startup profile:\n");
+    for (unsigned int i = 0; i < m_count; i++)
+    {
+        fmt::print(out, "  {:<20} {:9.3f} ms\n", m_phases[i].name, ms(m_phases[i].time).count());
+    }
+    fmt::print(out, "  {:<20} {:9.3f} ms\n", "total", ms(m_last - m_start).count());
+}
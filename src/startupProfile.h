@@ -0,0 +1,76 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef STARTUPPROFILE_H
+#define STARTUPPROFILE_H
+
+#include <chrono>
+#include <cstdio>
+
+/**
+ * Time spent in each startup phase, up to the first
+ * sample reaching the output.
+ */
+class startupProfile
+{
+public:
+    static constexpr unsigned int MAX_PHASES = 16;
+
+private:
+    typedef std::chrono::steady_clock clock;
+
+    struct phase_t
+    {
+        const char *name;
+        clock::duration time;
+    };
+
+    const clock::time_point m_start;
+    clock::time_point m_last;
+
+    phase_t m_phases[MAX_PHASES];
+    unsigned int m_count;
+    bool m_done;
+
+public:
+    startupProfile() :
+        m_start(clock::now()),
+        m_last(m_start),
+        m_count(0),
+        m_done(false)
+    {}
+
+    /**
+     * End a phase, no-op once the profile is finished.
+     *
+     * @param name the phase that ended, a static string
+     */
+    void mark(const char *name);
+
+    /// Stop recording.
+    void finish() { m_done = true; }
+
+    bool finished() const { return m_done; }
+
+    /// Print the report.
+    void print(std::FILE *out) const;
+};
+
+#endif // STARTUPPROFILE_H
@@ -0,0 +1,414 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "stilIndex.h"
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "filesystem/filesystem.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <new>
+#include <system_error>
+
+#include <cstdio>
+#include <cstring>
+
+#include "utils.h"
+
+#ifdef HAVE_MMAP
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+#undef SEPARATOR
+#define SEPARATOR "/"
+
+namespace fs = ghc::filesystem;
+
+// Change when the index layout changes
+static constexpr uint32_t INDEX_VERSION = 1;
+
+static const char INDEX_MAGIC[8] = { 'S', 'P', 'F', 'S', 'T', 'I', 'L', '\0' };
+
+// FNV-1a
+static constexpr uint64_t HASH_OFFSET = 0xcbf29ce484222325ULL;
+static constexpr uint64_t HASH_PRIME = 0x100000001b3ULL;
+
+struct indexHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    int64_t stilTime;
+    uint64_t stilSize;
+    int64_t bugTime;
+    uint64_t bugSize;
+    uint32_t pathsSize;
+    uint32_t reserved;
+};
+
+/*
+ * HVSC paths are matched ignoring case.
+ */
+static std::string fold(const char *str, std::size_t length)
+{
+    std::string result(str, length);
+    for (char &c : result)
+    {
+        if ((c >= 'A') && (c <= 'Z'))
+            c += 'a' - 'A';
+    }
+    return result;
+}
+
+static void fileStat(const std::string &name, int64_t &time, uint64_t &size)
+{
+    std::error_code ec;
+    const fs::file_time_type t = fs::last_write_time(name, ec);
+    const uintmax_t s = ec ? 0 : fs::file_size(name, ec);
+    time = ec ? 0 : static_cast<int64_t>(t.time_since_epoch().count());
+    size = ec ? 0 : s;
+}
+
+static bool readFile(const std::string &name, std::string &data)
+{
+    fs::ifstream is(name, std::ios::binary);
+    if (!is.is_open())
+        return false;
+    data.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+    return !is.bad();
+}
+
+stilIndex::stilIndex() :
+    m_data(nullptr),
+    m_size(0),
+    m_mapped(0),
+    m_records(nullptr),
+    m_count(0),
+    m_paths(nullptr)
+{}
+
+void stilIndex::release()
+{
+#ifdef HAVE_MMAP
+    if (m_mapped)
+        ::munmap(const_cast<char*>(m_data), m_mapped);
+#endif
+    m_mapped = 0;
+    m_buffer.clear();
+    m_data = nullptr;
+    m_size = 0;
+    m_records = nullptr;
+    m_count = 0;
+    m_paths = nullptr;
+}
+
+bool stilIndex::open(const char *hvscBase)
+{
+    release();
+
+    std::string base(hvscBase);
+    while (!base.empty() && ((base.back() == '/') || (base.back() == '\\')))
+        base.pop_back();
+
+    m_stilFile = base + SEPARATOR "DOCUMENTS" SEPARATOR "STIL.txt";
+    m_bugFile = base + SEPARATOR "DOCUMENTS" SEPARATOR "BUGlist.txt";
+
+    indexHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.version = INDEX_VERSION;
+    fileStat(m_stilFile, header.stilTime, header.stilSize);
+    fileStat(m_bugFile, header.bugTime, header.bugSize);
+    if (header.stilSize == 0)
+        return false;
+
+    std::string indexFile;
+    try
+    {
+        // One index per HVSC location
+        std::error_code ec;
+        const std::string location = fs::absolute(base, ec).string();
+        uint64_t hash = HASH_OFFSET;
+        for (const char c : location)
+        {
+            hash ^= static_cast<uint8_t>(c);
+            hash *= HASH_PRIME;
+        }
+
+        indexFile = utils::getCachePath();
+        indexFile.append(SEPARATOR).append("sidplayfp");
+        fs::create_directories(indexFile, ec);
+        char name[32];
+        std::snprintf(name, sizeof(name), "stil-%016llx.idx", static_cast<unsigned long long>(hash));
+        indexFile.append(SEPARATOR).append(name);
+    }
+    catch (utils::error const &e)
+    {
+        return false;
+    }
+
+    const std::string expected(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (load(indexFile, expected))
+        return true;
+
+    return build(indexFile, expected) && load(indexFile, expected);
+}
+
+bool stilIndex::load(const std::string &indexFile, const std::string &header)
+{
+#ifdef HAVE_MMAP
+    const int fd = ::open(indexFile.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if ((::fstat(fd, &st) == 0) && (static_cast<std::size_t>(st.st_size) >= sizeof(indexHeader)))
+    {
+        void *data = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            m_data = static_cast<const char*>(data);
+            m_size = m_mapped = st.st_size;
+        }
+    }
+    ::close(fd);
+#else
+    fs::ifstream is(indexFile, std::ios::binary | std::ios::ate);
+    if (!is.is_open())
+        return false;
+    try
+    {
+        m_buffer.resize(static_cast<std::size_t>(is.tellg()));
+    }
+    catch (std::bad_alloc const &ba)
+    {
+        return false;
+    }
+    is.seekg(0);
+    is.read(m_buffer.data(), m_buffer.size());
+    if (is.fail())
+    {
+        release();
+        return false;
+    }
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+#endif
+
+    if (m_size < sizeof(indexHeader))
+    {
+        release();
+        return false;
+    }
+
+    indexHeader stored;
+    std::memcpy(&stored, m_data, sizeof(stored));
+    const std::size_t recordsSize = static_cast<std::size_t>(stored.count) * sizeof(record_t);
+
+    // Ignore the counts when checking the source files
+    indexHeader check = stored;
+    check.count = 0;
+    check.pathsSize = 0;
+    if ((std::memcmp(&check, header.data(), sizeof(check)) != 0)
+        || (m_size != sizeof(indexHeader) + recordsSize + stored.pathsSize))
+    {
+        release();
+        return false;
+    }
+
+    m_records = reinterpret_cast<const record_t*>(m_data + sizeof(indexHeader));
+    m_count = stored.count;
+    m_paths = m_data + sizeof(indexHeader) + recordsSize;
+    return true;
+}
+
+bool stilIndex::build(const std::string &indexFile, const std::string &header) const
+{
+    struct entry_t
+    {
+        std::string path;
+        record_t record;
+    };
+
+    std::vector<entry_t> entries;
+
+    try
+    {
+        const std::string *files[] = { &m_stilFile, &m_bugFile };
+        const file_t types[] = { file_t::STIL, file_t::BUG };
+        for (int i = 0; i < 2; i++)
+        {
+            std::string data;
+            if (!readFile(*files[i], data))
+                continue;
+
+            // Entries start with the path and end at the first blank line
+            bool inEntry = false;
+            std::size_t pos = 0;
+            while (pos < data.size())
+            {
+                std::size_t eol = data.find('\n', pos);
+                const std::size_t next = (eol == std::string::npos) ? data.size() : eol + 1;
+                if (eol == std::string::npos)
+                    eol = data.size();
+                std::size_t end = eol;
+                if ((end > pos) && (data[end - 1] == '\r'))
+                    end--;
+
+                if (end == pos)
+                {
+                    inEntry = false;
+                }
+                else if (inEntry)
+                {
+                    entries.back().record.entryLength = next - entries.back().record.entryOffset;
+                }
+                else if (data[pos] == '/')
+                {
+                    inEntry = true;
+                    std::size_t pathEnd = end;
+                    while ((pathEnd > pos) && (data[pathEnd - 1] == ' '))
+                        pathEnd--;
+
+                    entry_t entry;
+                    entry.path = fold(data.data() + pos, pathEnd - pos);
+                    std::memset(&entry.record, 0, sizeof(entry.record));
+                    entry.record.entryOffset = pos;
+                    entry.record.entryLength = next - pos;
+                    entry.record.file = types[i];
+                    entries.push_back(entry);
+                }
+                pos = next;
+            }
+        }
+
+        std::stable_sort(entries.begin(), entries.end(),
+            [](const entry_t &a, const entry_t &b) {
+                return (a.path < b.path) || ((a.path == b.path) && (a.record.file < b.record.file)); });
+
+        // Keep the first of duplicated entries, like a sequential search
+        entries.erase(std::unique(entries.begin(), entries.end(),
+            [](const entry_t &a, const entry_t &b) {
+                return (a.path == b.path) && (a.record.file == b.record.file); }), entries.end());
+
+        std::string paths;
+        for (entry_t &entry : entries)
+        {
+            entry.record.pathOffset = paths.size();
+            entry.record.pathLength = entry.path.size();
+            paths.append(entry.path);
+        }
+
+        indexHeader stored;
+        std::memcpy(&stored, header.data(), sizeof(stored));
+        stored.count = entries.size();
+        stored.pathsSize = paths.size();
+
+        // Replace atomically, other instances may be reading it
+        const std::string tempFile = utils::tempName(indexFile);
+        {
+            fs::ofstream out(tempFile, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(&stored), sizeof(stored));
+            for (const entry_t &entry : entries)
+                out.write(reinterpret_cast<const char*>(&entry.record), sizeof(entry.record));
+            out.write(paths.data(), paths.size());
+            if (out.fail())
+                return false;
+        }
+        std::error_code ec;
+        fs::rename(tempFile, indexFile, ec);
+        if (ec)
+        {
+            fs::remove(tempFile, ec);
+            return false;
+        }
+    }
+    catch (std::bad_alloc const &ba)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+bool stilIndex::lookup(const std::string &path, file_t file, std::string &result) const
+{
+    const std::string key = fold(path.data(), path.size());
+
+    const record_t *end = m_records + m_count;
+    const record_t *it = std::lower_bound(m_records, end, key,
+        [this](const record_t &r, const std::string &k) {
+            const int cmp = k.compare(0, std::string::npos, m_paths + r.pathOffset, r.pathLength);
+            return cmp > 0; });
+
+    for (; it != end; ++it)
+    {
+        if (key.compare(0, std::string::npos, m_paths + it->pathOffset, it->pathLength) != 0)
+            return false;
+        if (it->file == file)
+            break;
+    }
+    if (it == end)
+        return false;
+
+    fs::ifstream is((file == file_t::STIL) ? m_stilFile : m_bugFile, std::ios::binary);
+    if (!is.is_open())
+        return false;
+
+    std::string data(it->entryLength, '\0');
+    is.seekg(it->entryOffset);
+    is.read(&data[0], it->entryLength);
+    if (is.fail())
+        return false;
+
+    // Normalize line endings
+    data.erase(std::remove(data.begin(), data.end(), '\r'), data.end());
+    if (data.empty() || (data.back() != '\n'))
+        data.push_back('\n');
+    result.swap(data);
+    return true;
+}
+
+bool stilIndex::getEntry(const char *relPath, std::string &result) const
+{
+    return lookup(relPath, file_t::STIL, result);
+}
+
+bool stilIndex::getGlobalComment(const char *relPath, std::string &result) const
+{
+    const char *slash = std::strrchr(relPath, '/');
+    if (slash == nullptr)
+        return false;
+
+    return lookup(std::string(relPath, slash + 1), file_t::STIL, result);
+}
+
+bool stilIndex::getBug(const char *relPath, std::string &result) const
+{
+    return lookup(relPath, file_t::BUG, result);
+}
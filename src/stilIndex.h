@@ -0,0 +1,111 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef STILINDEX_H
+#define STILINDEX_H
+
+#include <string>
+#include <vector>
+
+#include <cstddef>
+#include <stdint.h>
+
+/**
+ * Persistent index of the STIL and BUGlist entries.
+ *
+ * Maps each HVSC path to the position of its entry in the text
+ * files, so that a lookup is a binary search followed by reading
+ * a few lines instead of scanning the whole files.
+ * The index is built on first use and stored in the cache dir,
+ * it's rebuilt whenever one of the files changes.
+ *
+ * Only whole entries are looked up, extracting single tunes
+ * or fields is left to libstilview.
+ */
+class stilIndex
+{
+public:
+    enum class file_t : uint8_t
+    {
+        STIL,
+        BUG
+    };
+
+private:
+    struct record_t
+    {
+        uint32_t pathOffset;
+        uint32_t pathLength;
+        uint32_t entryOffset;
+        uint32_t entryLength;
+        file_t file;
+        uint8_t reserved[3];
+    };
+
+private:
+    std::string m_stilFile;
+    std::string m_bugFile;
+
+    const char *m_data;
+    std::size_t m_size;
+    /// Length of the mapping, zero if loaded in memory
+    std::size_t m_mapped;
+    std::vector<char> m_buffer;
+
+    const record_t *m_records;
+    uint32_t m_count;
+    const char *m_paths;
+
+private:
+    bool load(const std::string &indexFile, const std::string &header);
+    bool build(const std::string &indexFile, const std::string &header) const;
+    void release();
+
+    bool lookup(const std::string &path, file_t file, std::string &result) const;
+
+public:
+    stilIndex();
+    ~stilIndex() { release(); }
+
+    /**
+     * Open the index for the given HVSC, building it if needed.
+     *
+     * @param hvscBase the HVSC base directory
+     * @return false if the index is not available
+     */
+    bool open(const char *hvscBase);
+
+    /**
+     * Get the STIL entry of a tune.
+     *
+     * @param relPath the HVSC relative path
+     * @param result the whole entry
+     * @return false if there is no entry
+     */
+    bool getEntry(const char *relPath, std::string &result) const;
+
+    /// Get the global comment of the tune's directory.
+    bool getGlobalComment(const char *relPath, std::string &result) const;
+
+    /// Get the BUGlist entry of a tune.
+    bool getBug(const char *relPath, std::string &result) const;
+};
+
+#endif // STILINDEX_H
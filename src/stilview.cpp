@@ -27,6 +27,7 @@
 
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
 
 #include <cstdio>
@@ -37,6 +38,8 @@
 
 #include <stilview/stil.h>
 
+#include "stilIndex.h"
+
 #include "sidcxx11.h"
 
 STIL myStil;
@@ -50,6 +53,8 @@ bool showSection = true;
 bool showVersion = false;
 bool interactive = false;
 bool demo = false;
+bool batch = false;
+char *batchFile = nullptr;
 
 
 char STIL_DEMO_ENTRY[]="/Galway_Martin/Green_Beret.sid";
@@ -82,11 +87,42 @@ bool strEquals(const char* s1, const char* s2)
     return !(*s1 || *s2);
 }
 
+const char *const fieldNames[] = { "all", "name", "author", "title", "artist", "comment" };
+
+bool parseField(const char* fieldStr, STIL::STILField &value)
+{
+    const STIL::STILField fields[] = { STIL::all, STIL::name, STIL::author, STIL::title, STIL::artist, STIL::comment };
+
+    for (unsigned int i = 0; i < sizeof(fields) / sizeof(*fields); i++)
+    {
+        if (strEquals(fieldStr, fieldNames[i]))
+        {
+            value = fields[i];
+            return true;
+        }
+    }
+
+    return false;
+}
+
+const char *fieldName(STIL::STILField value)
+{
+    switch (value)
+    {
+        case STIL::name:    return fieldNames[1];
+        case STIL::author:  return fieldNames[2];
+        case STIL::title:   return fieldNames[3];
+        case STIL::artist:  return fieldNames[4];
+        case STIL::comment: return fieldNames[5];
+        default:            return fieldNames[0];
+    }
+}
+
 void printUsageStr(void)
 {
     fmt::print("\n{}", myStil.getVersion());
     fmt::print("USAGE: STILView [-e=<entry>] [-l=<HVSC loc>] [-t=<tuneNo>] [-f=<field>]\n");
-    fmt::print("                [-d] [-i] [-s] [-b] [-o] [-v] [-h] [-m]\n");
+    fmt::print("                [-d] [-i] [-j[=<file>]] [-s] [-b] [-o] [-v] [-h] [-m]\n");
 }
 
 void printUsage(void)
@@ -111,6 +147,9 @@ void printHelp(void)
     fmt::print("                all, name, author, title, artist, comment\n");
     fmt::print("-d            - Turns on debug mode for STILView.\n");
     fmt::print("-i            - Enter interactive mode.\n");
+    fmt::print("-j[=<file>]   - Batch mode: read queries from the file, or stdin if not\n");
+    fmt::print("                specified, one per line as '<entry> [<tuneNo> [<field>]]'\n");
+    fmt::print("                and print the results as JSON Lines.\n");
     fmt::print("-m            - Demo mode (tests STILView and shows its capabilities).\n");
     fmt::print("-s            - If specified, section-global (per dir/per composer) comments\n");
     fmt::print("                will NOT be printed.\n");
@@ -163,6 +202,11 @@ void processArguments(int argc, char **argv)
                 case 'I':
                     interactive = true;
                     break;
+                case 'j':
+                case 'J':
+                    batch = true;
+                    batchFile = getArgValue(argv[i]);
+                    break;
                 case 'm':
                 case 'M':
                     demo = true;
@@ -211,25 +255,7 @@ void processArguments(int argc, char **argv)
                         fmt::print(stderr, "ERROR: field was not specified correctly!\n");
                         printUsage();
                     }
-                    if (strEquals(fieldStr, "all")) {
-                        field = STIL::all;
-                    }
-                    else if (strEquals(fieldStr, "name")) {
-                        field = STIL::name;
-                    }
-                    else if (strEquals(fieldStr, "author")) {
-                        field = STIL::author;
-                    }
-                    else if (strEquals(fieldStr, "title")) {
-                        field = STIL::title;
-                    }
-                    else if (strEquals(fieldStr, "artist")) {
-                        field = STIL::artist;
-                    }
-                    else if (strEquals(fieldStr, "comment")) {
-                        field = STIL::comment;
-                    }
-                    else {
+                    if (!parseField(fieldStr, field)) {
                         fmt::print(stderr, "ERROR: Unknown STIL field specified: '{}' !\n", fieldStr);
                         fmt::print(stderr, "Valid values for <field> are:\n");
                         fmt::print(stderr, "all, name, author, title, artist, comment.\n");
@@ -259,7 +285,7 @@ void checkArguments(void)
 {
     if (hvscLoc == nullptr)
     {
-        if (interactive || demo)
+        if ((interactive || demo) && !batch)
         {
             hvscLoc = new char[STIL_MAX_PATH_SIZE];
             fmt::print("Enter HVSC base directory: ");
@@ -282,7 +308,7 @@ void checkArguments(void)
         }
     }
 
-    if (entryStr == nullptr)
+    if ((entryStr == nullptr) && !batch)
     {
         if ((!interactive) && (!demo))
         {
@@ -304,6 +330,158 @@ void checkArguments(void)
     }
 }
 
+bool parseTune(const char* tuneStr, int &value)
+{
+    char *end;
+    const long tune = std::strtol(tuneStr, &end, 10);
+    if ((*end != '\0') || (tune < 0) || (tune > 256))
+        return false;
+
+    value = static_cast<int>(tune);
+    return true;
+}
+
+// Append a JSON string literal, or null
+void appendJson(std::string &out, const char* str)
+{
+    if (str == nullptr)
+    {
+        out.append("null");
+        return;
+    }
+
+    out.push_back('"');
+    for (; *str; str++)
+    {
+        const unsigned char ch = static_cast<unsigned char>(*str);
+        switch (ch)
+        {
+            case '"':  out.append("\\\""); break;
+            case '\\': out.append("\\\\"); break;
+            case '\n': out.append("\\n"); break;
+            case '\r': out.append("\\r"); break;
+            case '\t': out.append("\\t"); break;
+            default:
+                if (ch < 0x20)
+                    out.append(fmt::format("\\u{:04x}", ch));
+                else
+                    out.push_back(static_cast<char>(ch));
+                break;
+        }
+    }
+    out.push_back('"');
+}
+
+// Append a result converted to UTF-8
+void appendResult(std::string &out, const char* name, const char* str, codeConvert &cvt)
+{
+    out.append(",\"");
+    out.append(name);
+    out.append("\":");
+    appendJson(out, str != nullptr ? cvt.convert(str) : nullptr);
+}
+
+/*
+ * Answer the queries read from the stream, one per line.
+ *
+ * Whole entries come from the index when available, the STIL
+ * database is parsed only once, by the first query that needs it.
+ */
+int runBatch(std::istream &in, codeConvert &cvt)
+{
+    stilIndex index;
+    const bool haveIndex = !myStil.STIL_DEBUG && index.open(hvscLoc);
+    bool stilLoaded = false;
+
+    std::string line, path, tuneStr, fieldStr, section, entry, bug, out;
+    while (std::getline(in, line))
+    {
+        std::istringstream query(line);
+        if (!(query >> path) || (path[0] == '#'))
+            continue;
+
+        tuneStr.clear();
+        fieldStr.clear();
+        query >> tuneStr >> fieldStr;
+
+        int tune = 0;
+        STIL::STILField queryField = STIL::all;
+        const char *error = nullptr;
+
+        if (path[0] != '/')
+        {
+            error = "entry is not an HVSC-relative path";
+        }
+        else if (!tuneStr.empty() && !parseTune(tuneStr.c_str(), tune))
+        {
+            error = "invalid tune number";
+        }
+        else if (!fieldStr.empty() && !parseField(fieldStr.c_str(), queryField))
+        {
+            error = "unknown field";
+        }
+
+        out.assign("{\"entry\":");
+        appendJson(out, path.c_str());
+
+        if (error != nullptr)
+        {
+            out.append(",\"error\":");
+            appendJson(out, error);
+        }
+        else
+        {
+            out.append(fmt::format(",\"tune\":{},\"field\":\"{}\"", tune, fieldName(queryField)));
+
+            const bool wholeEntry = haveIndex && (tune == 0) && (queryField == STIL::all);
+
+            if (!stilLoaded && !wholeEntry)
+            {
+                if (myStil.setBaseDir(hvscLoc) != true)
+                {
+                    fmt::print(stderr, "STIL error #{}: {}\n", myStil.getError(), myStil.getErrorStr());
+                    return EXIT_FAILURE;
+                }
+                stilLoaded = true;
+            }
+
+            const char *p = path.c_str();
+
+            if (showSection)
+            {
+                const char *sectionPtr = haveIndex
+                    ? (index.getGlobalComment(p, section) ? section.c_str() : nullptr)
+                    : myStil.getGlobalComment(p);
+                appendResult(out, "global", sectionPtr, cvt);
+            }
+
+            if (showEntry)
+            {
+                const char *entryPtr = wholeEntry
+                    ? (index.getEntry(p, entry) ? entry.c_str() : nullptr)
+                    : myStil.getEntry(p, tune, queryField);
+                appendResult(out, "stil", entryPtr, cvt);
+            }
+
+            if (showBug)
+            {
+                const char *bugPtr = wholeEntry
+                    ? (index.getBug(p, bug) ? bug.c_str() : nullptr)
+                    : myStil.getBug(p, tune);
+                appendResult(out, "bug", bugPtr, cvt);
+            }
+        }
+
+        out.append("}\n");
+
+        // Flush each answer so that the tool can be driven through a pipe
+        std::fwrite(out.data(), 1, out.size(), stdout);
+        std::fflush(stdout);
+    }
+
+    return EXIT_SUCCESS;
+}
+
 int main(int argc, char **argv)
 {
     const char *tmpptr, *sectionPtr, *entryPtr, *bugPtr;
@@ -323,6 +501,20 @@ int main(int argc, char **argv)
 
     codeConvert cvt;
 
+    if (batch)
+    {
+        if (batchFile == nullptr)
+            return runBatch(std::cin, cvt);
+
+        std::ifstream in(batchFile);
+        if (!in.is_open())
+        {
+            fmt::print(stderr, "ERROR: cannot open '{}'!\n", batchFile);
+            exit(EXIT_FAILURE);
+        }
+        return runBatch(in, cvt);
+    }
+
     if (interactive || demo) {
         fmt::print("Reading STIL...\n");
     }
@@ -344,7 +536,14 @@ int main(int argc, char **argv)
         }
     }
 
-    if (myStil.setBaseDir(hvscLoc) != true)
+    // Whole entries can be looked up in the index
+    // without parsing the STIL files
+    stilIndex index;
+    const bool useIndex = !interactive && !demo && !showVersion && !myStil.STIL_DEBUG
+        && (tuneNo == 0) && (field == STIL::all) && (entryStr[0] == '/')
+        && index.open(hvscLoc);
+
+    if (!useIndex && (myStil.setBaseDir(hvscLoc) != true))
     {
         fmt::print(stderr, "STIL error #{}: {}\n", myStil.getError(), myStil.getErrorStr());
         exit(EXIT_FAILURE);
@@ -363,8 +562,13 @@ int main(int argc, char **argv)
             versionPtr = nullptr;
         }
 
+        std::string section, entry, bug;
+
         if (showSection) {
-            sectionPtr = myStil.getGlobalComment(entryStr);
+            if (useIndex)
+                sectionPtr = index.getGlobalComment(entryStr, section) ? section.c_str() : nullptr;
+            else
+                sectionPtr = myStil.getGlobalComment(entryStr);
         }
         else
         {
@@ -373,7 +577,10 @@ int main(int argc, char **argv)
 
         if (showEntry)
         {
-            entryPtr = myStil.getEntry(entryStr, tuneNo, field);
+            if (useIndex)
+                entryPtr = index.getEntry(entryStr, entry) ? entry.c_str() : nullptr;
+            else
+                entryPtr = myStil.getEntry(entryStr, tuneNo, field);
         }
         else {
             entryPtr = nullptr;
@@ -381,7 +588,10 @@ int main(int argc, char **argv)
 
         if (showBug)
         {
-            bugPtr = myStil.getBug(entryStr, tuneNo);
+            if (useIndex)
+                bugPtr = index.getBug(entryStr, bug) ? bug.c_str() : nullptr;
+            else
+                bugPtr = myStil.getBug(entryStr, tuneNo);
         }
         else {
             bugPtr = nullptr;
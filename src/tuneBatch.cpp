@@ -0,0 +1,92 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "tuneBatch.h"
+
+#include "filesystem/filesystem.hpp"
+
+#include <algorithm>
+#include <thread>
+
+#include <cstdlib>
+
+namespace fs = ghc::filesystem;
+
+// Upper limit for the -j option
+constexpr long MAX_THREADS = 1024;
+
+static bool isTune(const fs::path &path)
+{
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(),
+        [](char c) { return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c; });
+    return ext == ".sid";
+}
+
+bool scanTunes(const std::string &root, std::vector<std::string> &paths, std::string &error)
+{
+    std::error_code ec;
+    const fs::path rootPath(root);
+    fs::recursive_directory_iterator it(rootPath, fs::directory_options::skip_permission_denied, ec);
+    if (ec)
+    {
+        error = ec.message();
+        return false;
+    }
+
+    for (; it != fs::recursive_directory_iterator(); it.increment(ec))
+    {
+        if (ec)
+            break;
+        if (!it->is_regular_file(ec) || !isTune(it->path()))
+            continue;
+
+        paths.push_back("/" + it->path().lexically_relative(rootPath).generic_string());
+    }
+
+    std::sort(paths.begin(), paths.end());
+    return true;
+}
+
+bool parseThreads(const char *str, unsigned int &threads)
+{
+    char *end;
+    const long value = std::strtol(str, &end, 10);
+    if ((end == str) || (*end != '\0') || (value <= 0) || (value > MAX_THREADS))
+        return false;
+    threads = static_cast<unsigned int>(value);
+    return true;
+}
+
+unsigned int poolSize(unsigned int threads, std::size_t items)
+{
+    if (threads == 0)
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    return std::min<std::size_t>(threads, std::max<std::size_t>(items, 1));
+}
+
+void runPool(unsigned int threads, const std::function<void(unsigned int)> &job)
+{
+    std::vector<std::thread> pool;
+    for (unsigned int i = 0; i < threads; i++)
+        pool.emplace_back(job, i);
+    for (auto &t : pool)
+        t.join();
+}
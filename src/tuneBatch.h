@@ -0,0 +1,69 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef TUNEBATCH_H
+#define TUNEBATCH_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <cstddef>
+
+/*
+ * Helpers for the tools processing a whole
+ * collection of tunes in parallel.
+ */
+
+/**
+ * List the SID files below a directory.
+ *
+ * @param root the directory
+ * @param paths filled with the HVSC style paths, relative
+ *        to the root with a leading slash, sorted
+ * @param error set to the reason if the directory can't be read
+ * @return false if the directory can't be read
+ */
+bool scanTunes(const std::string &root, std::vector<std::string> &paths, std::string &error);
+
+/**
+ * Parse the argument of the -j option.
+ *
+ * @param str the number of threads
+ * @param threads set to the value if valid
+ * @return false if not a positive number
+ */
+bool parseThreads(const char *str, unsigned int &threads);
+
+/**
+ * Get the number of threads to run.
+ *
+ * @param threads the requested number, zero for one per core
+ * @param items the number of items to process
+ */
+unsigned int poolSize(unsigned int threads, std::size_t items);
+
+/**
+ * Run a job on each thread of a pool and wait for all of them,
+ * the job is given the index of its thread.
+ */
+void runPool(unsigned int threads, const std::function<void(unsigned int)> &job);
+
+#endif // TUNEBATCH_H
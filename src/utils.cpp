@@ -20,8 +20,15 @@
 
 #include "utils.h"
 
+#include <functional>
+#include <thread>
+
 #include <cstdlib>
 
+#ifndef _WIN32
+#  include <unistd.h>
+#endif
+
 #ifdef _WIN32
 #  include <shlobj.h>
 #  include <shlwapi.h>
@@ -92,6 +99,8 @@ std::string utils::getDataPath() { return getPath(); }
 
 std::string utils::getConfigPath() { return getPath(); }
 
+std::string utils::getCachePath() { return getPath(); }
+
 #else
 
 std::string getPath(const char* id, const char* def)
@@ -116,4 +125,17 @@ std::string utils::getDataPath() { return getPath("XDG_DATA_HOME", "/.local/shar
 
 std::string utils::getConfigPath() { return getPath("XDG_CONFIG_HOME", "/.config"); }
 
+std::string utils::getCachePath() { return getPath("XDG_CACHE_HOME", "/.cache"); }
+
 #endif
+
+std::string utils::tempName(const std::string &path)
+{
+#ifdef _WIN32
+    const unsigned long pid = GetCurrentProcessId();
+#else
+    const unsigned long pid = static_cast<unsigned long>(getpid());
+#endif
+    const std::size_t thread = std::hash<std::thread::id>()(std::this_thread::get_id());
+    return path + "." + std::to_string(pid) + "-" + std::to_string(thread) + ".tmp";
+}
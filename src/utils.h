@@ -46,6 +46,19 @@ std::string getDataPath();
     */
 std::string getConfigPath();
 
+/**
+    * Get the system path for cache files.
+    *
+    * @throws error
+    */
+std::string getCachePath();
+
+/**
+    * Get a name for writing the given file before renaming it
+    * into place, unique to the calling process and thread.
+    */
+std::string tempName(const std::string &path);
+
 #ifdef _WIN32
 /**
     * Get the path of the executable.
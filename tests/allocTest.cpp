@@ -0,0 +1,211 @@
+/*
+ * This file is part of sidplayfp, a SID player.
+ *
+ * Copyright 2026 Leandro Nini <drfiemost@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+//
+// Play a short tune through each file driver and mixer
+// setting with the allocation check armed, the steady state
+// of the play loop must not use the heap.
+//
+
+#include "player.h"
+#include "allocCheck.h"
+#include "sidlib_features.h"
+
+#include "filesystem/filesystem.hpp"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <cstdio>
+#include <cstdlib>
+#include <stdint.h>
+
+namespace fs = ghc::filesystem;
+
+// Long enough for a few buffers after the first one
+static const char PLAY_TIME[] = "-t5";
+
+/*
+ * A PSID whose init routine turns the volume up and
+ * starts a voice, the play routine then writes a
+ * counter to the frequency register on each frame.
+ */
+static std::vector<uint8_t> makeTune()
+{
+    static const uint8_t code[] =
+    {
+        // $1000 init
+        0xa9, 0x0f,         // lda #$0f
+        0x8d, 0x18, 0xd4,   // sta $d418
+        0xa9, 0x11,         // lda #$11
+        0x8d, 0x04, 0xd4,   // sta $d404
+        0x60,               // rts
+        0xea, 0xea, 0xea, 0xea, 0xea,
+        // $1010 play
+        0xe6, 0xfb,         // inc $fb
+        0xa5, 0xfb,         // lda $fb
+        0x8d, 0x01, 0xd4,   // sta $d401
+        0x60                // rts
+    };
+
+    std::vector<uint8_t> tune(0x7c, 0);
+    const char magic[] = "PSID";
+    std::copy(magic, magic + 4, tune.begin());
+    tune[0x05] = 0x02;  // version
+    tune[0x07] = 0x7c;  // data offset
+    tune[0x0a] = 0x10;  // init address
+    tune[0x0c] = 0x10;  // play address
+    tune[0x0d] = 0x10;
+    tune[0x0f] = 0x01;  // songs
+    tune[0x11] = 0x01;  // start song
+    tune[0x77] = 0x14;  // PAL, 6581
+
+    // load address, then the code
+    tune.push_back(0x00);
+    tune.push_back(0x10);
+    tune.insert(tune.end(), code, code + sizeof(code));
+    return tune;
+}
+
+static void setEnv(const char *name, const std::string &value)
+{
+#ifdef _WIN32
+    _putenv_s(name, value.c_str());
+#else
+    setenv(name, value.c_str(), 1);
+#endif
+}
+
+/*
+ * Play the tune like the main loop does.
+ */
+static bool play(const std::vector<std::string> &options)
+{
+    std::vector<const char*> argv;
+    for (const std::string &option : options)
+        argv.push_back(option.c_str());
+
+    ConsolePlayer player("allocTest");
+    if (player.args(static_cast<int>(argv.size()), argv.data()) <= 0)
+        return false;
+
+    do
+    {
+        if (!player.open())
+        {
+            player.close();
+            return false;
+        }
+        while (player.play()) {}
+    }
+    while ((player.state() & ~playerFast) == playerRestart);
+
+    const bool ok = player.state() != playerError;
+    player.close();
+    return ok;
+}
+
+int main()
+{
+    std::error_code ec;
+    const fs::path dir = fs::temp_directory_path(ec) / fs::path("sidplayfp-alloctest");
+    fs::remove_all(dir, ec);
+    if (!fs::create_directories(dir, ec))
+    {
+        std::fprintf(stderr, "ERROR: Cannot create %s\n", dir.string().c_str());
+        return EXIT_FAILURE;
+    }
+
+    // Keep away from the user configuration and cache
+    setEnv("HOME", dir.string());
+    setEnv("XDG_CONFIG_HOME", (dir / "config").string());
+    setEnv("XDG_CACHE_HOME", (dir / "cache").string());
+    setEnv("XDG_DATA_HOME", (dir / "data").string());
+
+    const std::string tuneFile = (dir / "test.sid").string();
+    {
+        const std::vector<uint8_t> tune = makeTune();
+        std::ofstream out(tuneFile.c_str(), std::ios::binary);
+        out.write(reinterpret_cast<const char*>(tune.data()), tune.size());
+        if (out.fail())
+        {
+            std::fprintf(stderr, "ERROR: Cannot write %s\n", tuneFile.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+
+    const std::string out = (dir / "out").string();
+    const std::vector<std::string> drivers =
+    {
+        "-w" + out + ".wav",
+        "--au" + out + ".au",
+        "--flac" + out + ".flac",
+        "--raw" + out + ".raw",
+        "--noaudio"
+    };
+
+    const std::vector<std::vector<std::string>> settings =
+    {
+        {},
+        { "-m" },
+        { "-s" },
+        { "-p32" },
+#ifdef FEAT_NEW_PLAY_API
+        { "-s", "-ds0xd420", "-ts0xd440", "--pan=0,0.5,1" },
+        { "--chunk=100" },
+#endif
+        { "--loudness" },
+        { "--cache=16" }
+    };
+
+    allocCheck::countOnly();
+
+    bool ok = true;
+    for (const std::string &driver : drivers)
+    {
+        for (const std::vector<std::string> &setting : settings)
+        {
+            std::vector<std::string> options { "--alloc-check", "-q2", PLAY_TIME, driver };
+            options.insert(options.end(), setting.begin(), setting.end());
+            options.push_back(tuneFile);
+
+            std::string name = driver.substr(0, driver.find(out));
+            for (const std::string &option : setting)
+                name += " " + option;
+
+            const unsigned long allocations = allocCheck::allocations();
+            const unsigned long armings = allocCheck::armings();
+            const bool played = play(options);
+            const unsigned long buffers = allocCheck::armings() - armings;
+            const unsigned long count = allocCheck::allocations() - allocations;
+
+            const bool pass = played && (buffers > 0) && (count == 0);
+            std::printf("%s: %s, %lu buffers checked, %lu allocations\n",
+                pass ? "PASS" : "FAIL", name.c_str(), buffers, count);
+            if (!played)
+                std::printf("  playback failed\n");
+            ok &= pass;
+        }
+    }
+
+    fs::remove_all(dir, ec);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}